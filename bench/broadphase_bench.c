@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "../src/engine/util.h"
+#include "../src/engine/physics.h"
+#include "../src/engine/physics/physics_internal.h"
+#include "../src/engine/time.h"
+
+// Enemies walk back and forth along rows of platforms, like the level in
+// main.c. Compares the incremental sweep and prune, which only moves the
+// endpoints that changed order since the last frame, with testing every
+// pair of bodies, and checks both find the same pairs.
+
+#define PLATFORM_WIDTH 320
+#define PLATFORM_PITCH 48
+#define PLATFORMS_PER_ROW 16
+#define WALKERS_PER_PLATFORM 8
+#define WALKER_SIZE 12
+#define WALKER_SPEED 80
+#define FRAME_COUNT 60
+#define STEP_DELTA (1.0f / 60)
+
+typedef struct walker {
+    vec2 position;
+    f32 velocity;
+    f32 left;
+    f32 right;
+} Walker;
+
+static Walker *walkers_create(u32 count) {
+    Walker *walkers = malloc(count * sizeof(Walker) + 1);
+    if (!walkers) {
+        ERROR_EXIT("Could not allocate walkers\n");
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        u32 platform = i / WALKERS_PER_PLATFORM;
+        f32 left = (platform % PLATFORMS_PER_ROW) * PLATFORM_WIDTH;
+        f32 y = (platform / PLATFORMS_PER_ROW) * PLATFORM_PITCH;
+
+        walkers[i] = (Walker){
+            .position = {left + rand() % PLATFORM_WIDTH, y},
+            .velocity = rand() % 2 ? WALKER_SPEED : -WALKER_SPEED,
+            .left = left,
+            .right = left + PLATFORM_WIDTH,
+        };
+    }
+
+    return walkers;
+}
+
+// Walkers turn around at the edges of their platform.
+static void walkers_step(Walker *walkers, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        Walker *walker = &walkers[i];
+        walker->position[0] += walker->velocity * STEP_DELTA;
+
+        if (walker->position[0] < walker->left || walker->position[0] > walker->right) {
+            walker->velocity = -walker->velocity;
+        }
+    }
+}
+
+static void walkers_set(Sweep_And_Prune *sap, Walker *walkers, u32 count) {
+    sap_begin(sap, count);
+
+    for (u32 i = 0; i < count; i++) {
+        vec2 min = {walkers[i].position[0] - WALKER_SIZE * 0.5f, walkers[i].position[1] - WALKER_SIZE * 0.5f};
+        vec2 max = {walkers[i].position[0] + WALKER_SIZE * 0.5f, walkers[i].position[1] + WALKER_SIZE * 0.5f};
+        sap_set(sap, i, min, max);
+    }
+
+    sap_end(sap);
+}
+
+static void scene_run(u32 walker_count) {
+    srand(1);
+    Walker *walkers = walkers_create(walker_count);
+
+    Sweep_And_Prune sap;
+    sap_init(&sap);
+
+    // The first frame sorts from scratch, leave it out.
+    walkers_set(&sap, walkers, walker_count);
+
+    f64 sap_ns = 0;
+    f64 brute_force_ns = 0;
+    u32 mismatch_count = 0;
+    u64 pair_total = 0;
+
+    for (u32 frame = 0; frame < FRAME_COUNT; frame++) {
+        walkers_step(walkers, walker_count);
+
+        f64 start = time_now_ns();
+        walkers_set(&sap, walkers, walker_count);
+        f64 middle = time_now_ns();
+        u32 brute_force_count = sap_brute_force_pair_count(&sap);
+        f64 end = time_now_ns();
+
+        sap_ns += middle - start;
+        brute_force_ns += end - middle;
+        pair_total += sap.pair_count;
+
+        if (brute_force_count != sap.pair_count) {
+            mismatch_count++;
+        }
+    }
+
+    printf("%6u walkers: sweep and prune %10.0f ns/frame, brute force %12.0f ns/frame, %6.0f pairs/frame, %u mismatched frames\n",
+        walker_count, sap_ns / FRAME_COUNT, brute_force_ns / FRAME_COUNT, (f64)pair_total / FRAME_COUNT, mismatch_count);
+    fflush(stdout);
+
+    free(walkers);
+}
+
+int main(int argc, char *argv[]) {
+    u32 walker_counts[] = {1000, 5000, 10000};
+
+    for (u32 i = 0; i < sizeof(walker_counts) / sizeof(walker_counts[0]); i++) {
+        scene_run(walker_counts[i]);
+    }
+
+    return 0;
+}
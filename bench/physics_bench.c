@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <SDL2/SDL.h>
+
+#include "../src/engine/physics.h"
+#include "../src/engine/time.h"
+
+// Headless scene that fills a grid of rooms laid out like the level in
+// main.c with walking enemies, projectiles and fire pit triggers, then
+// reports the average cost of a physics step. Build with
+// PHYSICS_FIXED_POINT to measure the fixed point build, the hashes then
+// match on every machine.
+//
+// Without arguments a fixed set of scenes is run. Otherwise one scene is
+// run with the given counts:
+//   physics_bench [--static n] [--dynamic n] [--kinematic n]
+//                 [--triggers n] [--frames n] [--threads n] [--lod n]
+//                 [--sap 0|1]
+// With --lod, bodies outside the first room are stepped every n steps.
+// With --sap 1, moving bodies find each other by sweep and prune.
+
+#define ROOM_WIDTH 640
+#define ROOM_HEIGHT 360
+// The side walls reach below the room, keep rows apart so rooms never overlap.
+#define ROOM_PITCH (ROOM_HEIGHT * 2)
+#define BODIES_PER_ROOM 100
+#define STATICS_PER_ROOM 10
+#define DEFAULT_FRAME_COUNT 60
+
+typedef struct scene_config {
+    u32 static_count;
+    u32 dynamic_count;
+    u32 kinematic_count;
+    u32 trigger_count;
+    u32 frame_count;
+    u32 thread_count;
+    u32 lod_interval;
+    u32 is_sap_enabled;
+} Scene_Config;
+
+typedef enum collision_layer {
+    COLLISION_LAYER_PLAYER = 1,
+    COLLISION_LAYER_ENEMY = 1 << 1,
+    COLLISION_LAYER_TERRAIN = 1 << 2,
+    COLLISION_LAYER_ENEMY_PASSTHROUGH = 1 << 3,
+    COLLISION_LAYER_PROJECTILE = 1 << 4,
+} Collision_Layer;
+
+static u8 enemy_mask = COLLISION_LAYER_PLAYER | COLLISION_LAYER_TERRAIN;
+static u8 projectile_mask = COLLISION_LAYER_ENEMY | COLLISION_LAYER_TERRAIN;
+
+static u32 hit_count;
+static u32 trigger_event_count;
+
+static void enemy_on_hit_static(Body *self, Static_Body *other, Hit hit) {
+    hit_count++;
+
+    if (hit.contact == CONTACT_EXIT) {
+        return;
+    }
+
+    if (hit.normal[0] > 0) {
+        self->velocity[0] = 80;
+    } else if (hit.normal[0] < 0) {
+        self->velocity[0] = -80;
+    }
+}
+
+static void projectile_on_hit(Body *self, Body *other, Hit hit) {
+    hit_count++;
+}
+
+static void pit_on_trigger(Trigger *self, Body *other, Contact_State contact) {
+    trigger_event_count++;
+}
+
+static void projectile_on_hit_static(Body *self, Static_Body *other, Hit hit) {
+    hit_count++;
+
+    if (hit.contact == CONTACT_EXIT) {
+        return;
+    }
+
+    if (hit.normal[0] != 0) {
+        self->velocity[0] = hit.normal[0] * 200;
+    }
+}
+
+// Creates up to static_budget of the room's static bodies and returns how
+// many it created.
+static u32 room_create(f32 x, f32 y, u32 static_budget) {
+    f32 w = ROOM_WIDTH;
+    f32 h = ROOM_HEIGHT;
+
+    struct { vec2 position; vec2 size; } pieces[STATICS_PER_ROOM] = {
+        {{x + w * 0.5, y + h - 16}, {w, 32}},
+        {{x + w * 0.25 - 16, y + 16}, {w * 0.5 - 32, 48}},
+        {{x + w * 0.75 + 16, y + 16}, {w * 0.5 - 32, 48}},
+        {{x + 16, y + h * 0.5 - 3 * 32}, {32, h}},
+        {{x + w - 16, y + h * 0.5 - 3 * 32}, {32, h}},
+        {{x + 32 + 64, y + h - 32 * 3 - 16}, {128, 32}},
+        {{x + w - 32 - 64, y + h - 32 * 3 - 16}, {128, 32}},
+        {{x + w * 0.5, y + h - 32 * 3 - 16}, {192, 32}},
+        {{x + w * 0.5, y + 32 * 3 + 24}, {448, 32}},
+        // Close the fire pit so bodies don't pile up in the rooms below.
+        {{x + w * 0.5, y + 16}, {64, 48}},
+    };
+
+    u32 count = static_budget < STATICS_PER_ROOM ? static_budget : STATICS_PER_ROOM;
+    for (u32 i = 0; i < count; i++) {
+        physics_static_body_create(pieces[i].position, pieces[i].size, COLLISION_LAYER_TERRAIN);
+    }
+
+    return count;
+}
+
+static u32 div_ceil(u32 a, u32 b) {
+    return (a + b - 1) / b;
+}
+
+static void scene_create(Scene_Config *config) {
+    physics_reset();
+
+    u32 body_count = config->dynamic_count + config->kinematic_count;
+    u32 room_count = div_ceil(body_count, BODIES_PER_ROOM);
+    if (room_count < div_ceil(config->static_count, STATICS_PER_ROOM)) {
+        room_count = div_ceil(config->static_count, STATICS_PER_ROOM);
+    }
+    if (room_count < config->trigger_count) {
+        room_count = config->trigger_count;
+    }
+    if (room_count == 0) {
+        room_count = 1;
+    }
+
+    u32 columns = 1;
+    while (columns * columns < room_count) {
+        columns++;
+    }
+
+    u32 static_budget = config->static_count;
+    for (u32 i = 0; i < room_count; i++) {
+        static_budget -= room_create((i % columns) * ROOM_WIDTH, (i / columns) * ROOM_PITCH, static_budget);
+    }
+
+    // Like the fire in main.c, just above the closed pit of a room.
+    u8 pit_mask = COLLISION_LAYER_ENEMY | COLLISION_LAYER_PROJECTILE;
+    for (u32 i = 0; i < config->trigger_count; i++) {
+        f32 x = (i % columns) * ROOM_WIDTH + ROOM_WIDTH * 0.5;
+        f32 y = (i / columns) * ROOM_PITCH + 48;
+        physics_trigger_create((vec2){x, y}, (vec2){64, 16}, pit_mask, pit_on_trigger);
+    }
+
+    // Kinematic bodies are spread evenly among the dynamic ones.
+    for (u32 i = 0; i < body_count; i++) {
+        u32 room = (u32)((u64)i * room_count / body_count);
+        f32 x = (room % columns) * ROOM_WIDTH + 48 + rand() % (ROOM_WIDTH - 96);
+        f32 y = (room / columns) * ROOM_PITCH + 64 + rand() % (ROOM_HEIGHT - 128);
+        f32 speed = rand() % 2 ? 80 : -80;
+
+        if ((u64)i * config->kinematic_count % body_count < config->kinematic_count) {
+            physics_body_create((vec2){x, y}, (vec2){16, 16}, (vec2){speed * 2.5, 0}, COLLISION_LAYER_PROJECTILE, projectile_mask, true, projectile_on_hit, projectile_on_hit_static, i);
+        } else {
+            physics_body_create((vec2){x, y}, (vec2){12, 12}, (vec2){speed, 0}, COLLISION_LAYER_ENEMY, enemy_mask, false, NULL, enemy_on_hit_static, i);
+        }
+    }
+}
+
+static void scene_run(Scene_Config *config) {
+    physics_thread_count_set(config->thread_count);
+    physics_lod_set((AABB){{ROOM_WIDTH * 0.5, ROOM_HEIGHT * 0.5}, {ROOM_WIDTH * 0.5, ROOM_HEIGHT * 0.5}}, config->lod_interval);
+    physics_sweep_and_prune_set(config->is_sap_enabled);
+    srand(1);
+    scene_create(config);
+    hit_count = 0;
+    trigger_event_count = 0;
+
+    f64 start = time_now_ns();
+
+    for (u32 frame = 0; frame < config->frame_count; frame++) {
+        physics_step();
+    }
+
+    f64 ns = (time_now_ns() - start) / config->frame_count;
+    u32 body_count = config->dynamic_count + config->kinematic_count;
+    f64 substeps = (f64)physics_substep_count() / config->frame_count;
+
+    printf("%5u static, %6u dynamic, %5u kinematic, %4u triggers, %2u threads, lod %u, sap %u: %10.0f ns/step, %6.1f ns/body, %.0f substeps/step, %u hits, %u trigger events, hash %016" PRIx64 "\n",
+        config->static_count, config->dynamic_count, config->kinematic_count, config->trigger_count, config->thread_count, config->lod_interval, config->is_sap_enabled,
+        ns, body_count > 0 ? ns / body_count : 0, substeps, hit_count, trigger_event_count, physics_state_hash());
+    fflush(stdout);
+}
+
+// Same mix of bodies as the level in main.c: one in ten is a projectile.
+static Scene_Config scene_default(u32 body_count, u32 thread_count) {
+    return (Scene_Config){
+        .static_count = div_ceil(body_count, BODIES_PER_ROOM) * STATICS_PER_ROOM,
+        .dynamic_count = body_count - body_count / 10,
+        .kinematic_count = body_count / 10,
+        .frame_count = DEFAULT_FRAME_COUNT,
+        .thread_count = thread_count,
+        .lod_interval = 1,
+    };
+}
+
+static void usage_exit(void) {
+    fprintf(stderr, "usage: physics_bench [--static n] [--dynamic n] [--kinematic n] [--triggers n] [--frames n] [--threads n] [--lod n] [--sap 0|1]\n");
+    exit(1);
+}
+
+static void parse_args(Scene_Config *config, int argc, char *argv[]) {
+    struct { const char *name; u32 *value; } options[] = {
+        {"--static", &config->static_count},
+        {"--dynamic", &config->dynamic_count},
+        {"--kinematic", &config->kinematic_count},
+        {"--triggers", &config->trigger_count},
+        {"--frames", &config->frame_count},
+        {"--threads", &config->thread_count},
+        {"--lod", &config->lod_interval},
+        {"--sap", &config->is_sap_enabled},
+    };
+    u32 option_count = sizeof(options) / sizeof(options[0]);
+
+    for (int i = 1; i < argc; i += 2) {
+        u32 j = 0;
+        while (j < option_count && strcmp(argv[i], options[j].name) != 0) {
+            j++;
+        }
+
+        if (j == option_count || i + 1 >= argc) {
+            usage_exit();
+        }
+
+        *options[j].value = (u32)strtoul(argv[i + 1], NULL, 10);
+    }
+
+    if (config->frame_count == 0) {
+        usage_exit();
+    }
+
+    // Unless given, every room gets all of its static bodies.
+    if (config->static_count == (u32)-1) {
+        u32 body_count = config->dynamic_count + config->kinematic_count;
+        u32 room_count = div_ceil(body_count, BODIES_PER_ROOM);
+        if (room_count < config->trigger_count) {
+            room_count = config->trigger_count;
+        }
+        config->static_count = room_count * STATICS_PER_ROOM;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    physics_init();
+
+#ifdef PHYSICS_FIXED_POINT
+    printf("fixed point\n");
+#else
+    printf("float\n");
+#endif
+
+    if (argc > 1) {
+        Scene_Config config = scene_default(1000, 1);
+        config.static_count = (u32)-1;
+        parse_args(&config, argc, argv);
+        scene_run(&config);
+        return 0;
+    }
+
+    u32 thread_counts[] = {1, SDL_GetCPUCount()};
+    u32 body_counts[] = {1000, 5000, 10000};
+
+    for (u32 i = 0; i < 2; i++) {
+        for (u32 j = 0; j < 3; j++) {
+            Scene_Config config = scene_default(body_counts[j], thread_counts[i]);
+            scene_run(&config);
+        }
+    }
+
+    return 0;
+}
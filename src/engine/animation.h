@@ -3,6 +3,7 @@
 #include <stdbool.h>
 
 #include "render.h"
+#include "slot_map.h"
 
 #define MAX_FRAMES 16
 
@@ -23,14 +24,13 @@ typedef struct animation {
     f32 current_frame_time;
     u8 current_frame_index;
     bool does_loop;
-    bool is_active;
     bool is_flipped;
 } Animation;
 
 void animation_init(void);
 size_t animation_definition_create(Sprite_Sheet *sprite_sheet, f32 duration, u8 row, u8 *columns, u8 frame_count);
-size_t animation_create(size_t animation_definition_id, bool does_loop);
-void animation_destory(size_t id);
-Animation *animation_get(size_t id);
+Handle animation_create(size_t animation_definition_id, bool does_loop);
+void animation_destory(Handle id);
+Animation *animation_get(Handle id);
 void animation_update(f32 dt);
 void animation_render(Animation *animation, vec2 position, vec4 color, u32 texture_slots[8]);
@@ -2,14 +2,17 @@
 
 #include "../util.h"
 #include "../array_list.h"
+#include "../slot_map.h"
 #include "../animation.h"
 
+ARRAY_LIST_DEFINE(animation_definition_list, Animation_Definition)
+
 static Array_List *animation_definition_storage;
-static Array_List *animation_storage;
+static Slot_Map *animation_storage;
 
 void animation_init(void) {
     animation_definition_storage = array_list_create(sizeof(Animation_Definition), 0);
-    animation_storage = array_list_create(sizeof(Animation), 0);
+    animation_storage = slot_map_create(sizeof(Animation), 0);
 }
 
 size_t animation_definition_create(Sprite_Sheet *sprite_sheet, f32 duration, u8 row, u8 *columns, u8 frame_count) {
@@ -31,51 +34,34 @@ size_t animation_definition_create(Sprite_Sheet *sprite_sheet, f32 duration, u8
     return array_list_append(animation_definition_storage, &def);
 }
 
-size_t animation_create(size_t animation_definition_id, bool does_loop) {
-    size_t id = animation_storage->len;
+Handle animation_create(size_t animation_definition_id, bool does_loop) {
     Animation_Definition *adef = array_list_get(animation_definition_storage, animation_definition_id);
     if (adef == NULL) {
         ERROR_EXIT("Animation Definition with id %zu not found.", animation_definition_id);
     }
 
-    // Try to find free slot first
-    for (size_t i = 0; i < animation_storage->len; i++) {
-        Animation *animation = array_list_get(animation_storage, i);
-        if (!animation->is_active) {
-            id = i;
-            break;
-        }
-    }
-
-    if (id == animation_storage->len) {
-        array_list_append(animation_storage, &(Animation){0});
-    }
-
-    Animation *animation = array_list_get(animation_storage, id);
-
     // Other fields default to 0 when using field dot syntax.
-    *animation = (Animation){
+    Animation animation = {
         .animation_defination_id = animation_definition_id,
         .does_loop = does_loop,
-        .is_active = true,
     };
 
-    return id;
+    return slot_map_insert(animation_storage, &animation);
 }
 
-void animation_destory(size_t id) {
-    Animation *animation = array_list_get(animation_storage, id);
-    animation->is_active = false;
+void animation_destory(Handle id) {
+    slot_map_remove(animation_storage, id);
 }
 
-Animation *animation_get(size_t id) {
-    return array_list_get(animation_storage, id);
+// NULL once the animation has been destroyed.
+Animation *animation_get(Handle id) {
+    return slot_map_get(animation_storage, id);
 }
 
 void animation_update(f32 dt) {
-    for (size_t i = 0; i < animation_storage->len; i++) {
-        Animation *animation = array_list_get(animation_storage, i);
-        Animation_Definition *adef = array_list_get(animation_definition_storage, animation->animation_defination_id);
+    for (size_t i = 0; i < slot_map_count(animation_storage); i++) {
+        Animation *animation = slot_map_at(animation_storage, i);
+        Animation_Definition *adef = animation_definition_list_get(animation_definition_storage, animation->animation_defination_id);
         animation->current_frame_time -= dt;
 
         if (animation->current_frame_time <= 0) {
@@ -96,7 +82,7 @@ void animation_update(f32 dt) {
 }
 
 void animation_render(Animation *animation, vec2 position, vec4 color, u32 texture_slots[8]) {
-    Animation_Definition *adef = array_list_get(animation_definition_storage, animation->animation_defination_id);
+    Animation_Definition *adef = animation_definition_list_get(animation_definition_storage, animation->animation_defination_id);
     Animation_Frame *aframe = &adef->frames[animation->current_frame_index];
     render_sprite_sheet_frame(adef->sprite_sheet, aframe->row, aframe->column, position, animation->is_flipped, (vec4){1, 1, 1, 1}, texture_slots);
 }
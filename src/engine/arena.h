@@ -0,0 +1,23 @@
+#pragma once
+
+#include "types.h"
+
+typedef struct arena_block Arena_Block;
+
+// Bump allocator for data that is all freed at once. Allocating only moves
+// an offset. When the block runs out, further allocations come from
+// overflow blocks, and the next reset replaces all of them with one block
+// big enough for the high water mark. An arena that is reset every frame
+// stops calling malloc after its busiest frame.
+typedef struct arena {
+    u8 *memory;
+    size_t capacity;
+    size_t used;
+    size_t high_water;
+    Arena_Block *overflow;
+} Arena;
+
+void arena_init(Arena *arena, size_t capacity);
+void *arena_alloc(Arena *arena, size_t size);
+void arena_reset(Arena *arena);
+void arena_release(Arena *arena);
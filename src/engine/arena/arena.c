@@ -0,0 +1,95 @@
+#include <stdlib.h>
+
+#include "../util.h"
+#include "../arena.h"
+
+// Alignment of every allocation, enough for any type the engine stores.
+#define ARENA_ALIGN 16
+
+struct arena_block {
+    Arena_Block *next;
+    size_t capacity;
+    size_t used;
+    _Alignas(ARENA_ALIGN) u8 memory[];
+};
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static void *memory_alloc(size_t size) {
+    void *memory = aligned_alloc(ARENA_ALIGN, align_up(size));
+    if (!memory) {
+        ERROR_EXIT("Could not allocate %zu bytes for arena\n", size);
+    }
+
+    return memory;
+}
+
+// Nothing is allocated until the first arena_alloc.
+void arena_init(Arena *arena, size_t capacity) {
+    *arena = (Arena){.capacity = align_up(capacity)};
+}
+
+// Memory is aligned to 16 bytes and lives until the next reset or release.
+void *arena_alloc(Arena *arena, size_t size) {
+    size = align_up(size);
+
+    if (!arena->memory && arena->capacity > 0) {
+        arena->memory = memory_alloc(arena->capacity);
+    }
+
+    void *result;
+    if (arena->used + size <= arena->capacity && !arena->overflow) {
+        result = arena->memory + arena->used;
+    } else {
+        Arena_Block *block = arena->overflow;
+
+        if (!block || block->used + size > block->capacity) {
+            size_t capacity = size > arena->capacity ? size : arena->capacity;
+            block = memory_alloc(sizeof(Arena_Block) + capacity);
+            *block = (Arena_Block){.next = arena->overflow, .capacity = capacity};
+            arena->overflow = block;
+        }
+
+        result = block->memory + block->used;
+        block->used += size;
+    }
+
+    arena->used += size;
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+
+    return result;
+}
+
+static void overflow_free(Arena *arena) {
+    while (arena->overflow) {
+        Arena_Block *next = arena->overflow->next;
+        free(arena->overflow);
+        arena->overflow = next;
+    }
+}
+
+// Frees everything allocated since the last reset. Keeps the memory,
+// grown to the high water mark if it overflowed.
+void arena_reset(Arena *arena) {
+    if (arena->overflow) {
+        overflow_free(arena);
+        free(arena->memory);
+        arena->capacity = align_up(arena->high_water);
+        arena->memory = memory_alloc(arena->capacity);
+    }
+
+    arena->used = 0;
+}
+
+// Frees everything allocated and gives the memory back, the next
+// allocation starts from a block of the same capacity again.
+void arena_release(Arena *arena) {
+    overflow_free(arena);
+    free(arena->memory);
+    arena->memory = NULL;
+    arena->used = 0;
+}
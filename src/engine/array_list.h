@@ -1,15 +1,75 @@
 #pragma once
 
+#include "util.h"
 #include "types.h"
+#include "arena.h"
 
 typedef struct array_list {
     size_t len;
     size_t capacity;
     size_t item_size;
     void *items;
+    // Set for lists that live in an arena, NULL for malloc.
+    Arena *arena;
 } Array_List;
 
 Array_List *array_list_create(size_t item_size, size_t initial_capacity);
+Array_List *array_list_create_in(Arena *arena, size_t item_size, size_t initial_capacity);
 size_t array_list_append(Array_List *list, void *item);
 void *array_list_get(Array_List *list, size_t index);
 u8 array_list_remove(Array_List *list, size_t index);
+void array_list_grow(Array_List *list, size_t capacity);
+void array_list_reserve(Array_List *list, size_t count);
+void *array_list_emplace_n(Array_List *list, size_t count);
+size_t array_list_append_n(Array_List *list, const void *items, size_t count);
+
+// Checks the typed accessors do in debug builds. Release builds, with
+// NDEBUG, trust the caller.
+#ifndef NDEBUG
+#define ARRAY_LIST_CHECK(list, index, type) do { \
+    if ((list)->item_size != sizeof(type)) \
+        ERROR_EXIT("Array_List of %zu byte items used as " #type "\n", (list)->item_size); \
+    if ((index) >= (list)->len) \
+        ERROR_EXIT("Index %zu out of bounds of Array_List of %zu\n", (size_t)(index), (list)->len); \
+} while (0)
+#else
+#define ARRAY_LIST_CHECK(list, index, type) do {} while (0)
+#endif
+
+// Declares accessors for an Array_List holding type, named after prefix:
+//   type *prefix_get(Array_List *list, size_t index)
+//   type *prefix_emplace(Array_List *list)
+//   type *prefix_emplace_n(Array_List *list, size_t count)
+//   void prefix_append(Array_List *list, type item)
+// They are inline and index with the size of type, so a loop over them
+// compiles down to plain array accesses. emplace returns the new last item
+// for the caller to fill in, emplace_n the first of count new items.
+// Running out of memory exits.
+#define ARRAY_LIST_DEFINE(prefix, type) \
+    static inline type *prefix##_get(Array_List *list, size_t index) { \
+        ARRAY_LIST_CHECK(list, index, type); \
+        return (type*)list->items + index; \
+    } \
+    \
+    static inline type *prefix##_emplace_n(Array_List *list, size_t count) { \
+        if (list->len + count > list->capacity) { \
+            array_list_grow(list, list->len + count); \
+        } \
+        size_t index = list->len; \
+        list->len += count; \
+        if (count > 0) { \
+            ARRAY_LIST_CHECK(list, index + count - 1, type); \
+        } \
+        return (type*)list->items + index; \
+    } \
+    \
+    static inline type *prefix##_emplace(Array_List *list) { \
+        return prefix##_emplace_n(list, 1); \
+    } \
+    \
+    static inline void prefix##_append(Array_List *list, type item) { \
+        *prefix##_emplace(list) = item; \
+    }
+
+ARRAY_LIST_DEFINE(u32_list, u32)
+ARRAY_LIST_DEFINE(size_list, size_t)
@@ -14,6 +14,7 @@ Array_List *array_list_create(size_t item_size, size_t initial_capacity) {
     list->capacity = initial_capacity;
     list->len = 0;
     list->items = malloc(item_size * initial_capacity);
+    list->arena = NULL;
 
     if (!list->items)
         ERROR_RETURN(NULL, "Could not allocate memory for Array_List\n")
@@ -21,10 +22,37 @@ Array_List *array_list_create(size_t item_size, size_t initial_capacity) {
     return list;
 }
 
+// The list and its items come from arena and go away with it. Growing
+// allocates a new copy of the items, the old one is only reclaimed with the
+// rest of the arena.
+Array_List *array_list_create_in(Arena *arena, size_t item_size, size_t initial_capacity) {
+    Array_List *list = arena_alloc(arena, sizeof(Array_List));
+
+    *list = (Array_List){
+        .capacity = initial_capacity,
+        .item_size = item_size,
+        .items = arena_alloc(arena, item_size * initial_capacity),
+        .arena = arena,
+    };
+
+    return list;
+}
+
+static void *items_resize(Array_List *list, size_t capacity) {
+    if (!list->arena) {
+        return realloc(list->items, list->item_size * capacity);
+    }
+
+    void *items = arena_alloc(list->arena, list->item_size * capacity);
+    memcpy(items, list->items, list->item_size * list->len);
+
+    return items;
+}
+
 size_t array_list_append(Array_List *list, void *item) {
     if (list->len == list->capacity) {
         list->capacity = list->capacity > 0 ? list->capacity * 2 : 1;
-        void *items = realloc (list->items, list->item_size * list->capacity);
+        void *items = items_resize(list, list->capacity);
 
         if (!items)
             ERROR_RETURN(-1, "Could not allocate memory for Array_List\n");
@@ -39,6 +67,50 @@ size_t array_list_append(Array_List *list, void *item) {
     return index;
 }
 
+// Doubles capacity until it holds at least capacity items.
+void array_list_grow(Array_List *list, size_t capacity) {
+    if (capacity <= list->capacity) {
+        return;
+    }
+
+    size_t new_capacity = list->capacity > 0 ? list->capacity : 1;
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+
+    void *items = items_resize(list, new_capacity);
+    if (!items)
+        ERROR_EXIT("Could not allocate memory for Array_List\n");
+
+    list->items = items;
+    list->capacity = new_capacity;
+}
+
+// Makes room for count more items, so appending them won't grow the list
+// again.
+void array_list_reserve(Array_List *list, size_t count) {
+    array_list_grow(list, list->len + count);
+}
+
+// Adds count items left uninitialized and returns the first one, for the
+// caller to fill in. Grows at most once.
+void *array_list_emplace_n(Array_List *list, size_t count) {
+    array_list_reserve(list, count);
+
+    u8 *items = (u8*)list->items + list->len * list->item_size;
+    list->len += count;
+
+    return items;
+}
+
+// Returns the index of the first of the appended items.
+size_t array_list_append_n(Array_List *list, const void *items, size_t count) {
+    size_t index = list->len;
+    memcpy(array_list_emplace_n(list, count), items, count * list->item_size);
+
+    return index;
+}
+
 void *array_list_get(Array_List *list, size_t index) {
     if (index >= list->len)
         ERROR_RETURN(NULL, "Index out of bounds\n");
@@ -1,51 +1,77 @@
-#include "../array_list.h"
+#include "../slot_map.h"
 #include "../entity.h"
 #include "../util.h"
+#include "../global.h"
 
-static Array_List *entity_list;
+static Slot_Map *entity_map;
 
 void entity_init(void) {
-    entity_list = array_list_create(sizeof(Entity), 0);
+    entity_map = slot_map_create(sizeof(Entity), 0);
 }
 
-size_t entity_create(vec2 position, vec2 size, vec2 sprite_offset, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, size_t animation_id, On_Hit on_hit, On_Hit_Static on_hit_static) {
-    size_t id = entity_list->len;
-
-    // Find inactive Entity.
-    for (size_t i = 0; i < entity_list->len; i++) {
-        Entity *entity = array_list_get(entity_list, i);
-        if (!entity->is_active) {
-            id = i;
-            break;
-        }
-    }
-
-    if (id == entity_list->len) {
-        if (array_list_append(entity_list, &(Entity){0}) == (size_t)-1) {
-            ERROR_EXIT("Could not append entity to list\n");
-        }
-    }
+Handle entity_create(vec2 position, vec2 size, vec2 sprite_offset, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, Handle animation_id, On_Hit on_hit, On_Hit_Static on_hit_static) {
+    Handle id = slot_map_insert(entity_map, &(Entity){0});
+    Handle body_id = physics_body_create(position, size, velocity, collision_layer, collision_mask, is_kinematic, on_hit, on_hit_static, id);
 
     Entity *entity = entity_get(id);
 
     *entity = (Entity){
-        .is_active = true,
         .animation_id = animation_id,
-        .body_id = physics_body_create(position, size, velocity, collision_layer, collision_mask, is_kinematic, on_hit, on_hit_static, id),
+        .body_id = body_id,
         .sprite_offset = { sprite_offset[0], sprite_offset[1] },
     };
 
     return id;
 }
 
-Entity *entity_get(size_t id) {
-    return array_list_get(entity_list, id);
+// Creates count entities alike but for their position, for spawning a
+// group at once without growing the entities or bodies one at a time. ids
+// receives their handles and may be NULL.
+void entity_create_batch(Handle *ids, vec2 *positions, size_t count, vec2 size, vec2 sprite_offset, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, Handle animation_id, On_Hit on_hit, On_Hit_Static on_hit_static) {
+    Handle *entity_ids = ids ? ids : arena_alloc(&global.frame_arena, count * sizeof(Handle));
+    Handle *body_ids = arena_alloc(&global.frame_arena, count * sizeof(Handle));
+
+    // The bodies need the entity handles, so the entities go first and get
+    // their bodies after.
+    slot_map_reserve(entity_map, count);
+    for (size_t i = 0; i < count; i++) {
+        entity_ids[i] = slot_map_insert(entity_map, &(Entity){
+            .animation_id = animation_id,
+            .sprite_offset = { sprite_offset[0], sprite_offset[1] },
+        });
+    }
+
+    physics_body_create_batch(body_ids, positions, count, size, velocity, collision_layer, collision_mask, is_kinematic, on_hit, on_hit_static, entity_ids);
+
+    for (size_t i = 0; i < count; i++) {
+        entity_get(entity_ids[i])->body_id = body_ids[i];
+    }
+}
+
+// NULL once the entity has been destroyed.
+Entity *entity_get(Handle id) {
+    return slot_map_get(entity_map, id);
 }
 
 size_t entity_count() {
-    return entity_list->len;
+    return slot_map_count(entity_map);
+}
+
+// Entities that aren't destroyed, for index < entity_count(). Destroying an
+// entity moves the last one into its index.
+Entity *entity_at(size_t index) {
+    return slot_map_at(entity_map, index);
 }
 
 void entity_reset(void) {
-    entity_list->len = 0;
+    slot_map_clear(entity_map);
+}
+
+void entity_destroy(Handle entity_id) {
+    Entity *entity = entity_get(entity_id);
+
+    if (entity) {
+        physics_body_destroy(entity->body_id);
+        slot_map_remove(entity_map, entity_id);
+    }
 }
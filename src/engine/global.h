@@ -5,11 +5,16 @@
 #include "config.h"
 #include "input.h"
 #include "time.h"
+#include "arena.h"
 
 typedef struct global {
     Config_State config;
     Input_State input;
     Time_State time;
+    // Reset at the start of every frame.
+    Arena frame_arena;
+    // Released when the level is reset.
+    Arena level_arena;
 } Global;
 
 extern Global global;
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "types.h"
+#include "array_list.h"
+
+// Items per page, a power of two.
+#define PAGED_LIST_PAGE_SIZE 256
+#define PAGED_LIST_PAGE_SHIFT 8
+
+// List whose items never move once appended. Items live in fixed size pages
+// found through a directory of page pointers, so growing only adds a page
+// and copies nothing but the directory. Pointers to items stay valid until
+// the list is shrunk past them.
+typedef struct paged_list {
+    size_t len;
+    size_t item_size;
+    Array_List *page_list;
+} Paged_List;
+
+Paged_List *paged_list_create(size_t item_size);
+size_t paged_list_append(Paged_List *list, void *item);
+void paged_list_resize(Paged_List *list, size_t len);
+void paged_list_reserve(Paged_List *list, size_t count);
+void paged_list_copy_out(Paged_List *list, void *destination);
+void paged_list_copy_in(Paged_List *list, const void *source);
+
+static inline void *paged_list_get(Paged_List *list, size_t index) {
+#ifndef NDEBUG
+    if (index >= list->len)
+        ERROR_EXIT("Index %zu out of bounds of Paged_List of %zu\n", index, list->len);
+#endif
+    u8 *page = ((u8**)list->page_list->items)[index >> PAGED_LIST_PAGE_SHIFT];
+    return page + (index & (PAGED_LIST_PAGE_SIZE - 1)) * list->item_size;
+}
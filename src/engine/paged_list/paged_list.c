@@ -0,0 +1,77 @@
+#include <string.h>
+
+#include "../util.h"
+#include "../paged_list.h"
+
+Paged_List *paged_list_create(size_t item_size) {
+    Paged_List *list = malloc(sizeof(Paged_List));
+
+    if (!list)
+        ERROR_RETURN(NULL, "Could not allocate memory for Paged_List\n");
+
+    *list = (Paged_List){
+        .item_size = item_size,
+        .page_list = array_list_create(sizeof(u8*), 0),
+    };
+
+    return list;
+}
+
+// Allocates the pages for count more items without adding them.
+void paged_list_reserve(Paged_List *list, size_t count) {
+    size_t page_count = (list->len + count + PAGED_LIST_PAGE_SIZE - 1) >> PAGED_LIST_PAGE_SHIFT;
+
+    while (list->page_list->len < page_count) {
+        u8 *page = malloc(PAGED_LIST_PAGE_SIZE * list->item_size);
+        if (!page) {
+            ERROR_EXIT("Could not allocate page for Paged_List\n");
+        }
+
+        if (array_list_append(list->page_list, &page) == (size_t)-1) {
+            ERROR_EXIT("Could not append page to Paged_List\n");
+        }
+    }
+}
+
+// Pages are kept when the list shrinks and reused when it grows again.
+void paged_list_resize(Paged_List *list, size_t len) {
+    if (len > list->len) {
+        paged_list_reserve(list, len - list->len);
+    }
+
+    list->len = len;
+}
+
+size_t paged_list_append(Paged_List *list, void *item) {
+    size_t index = list->len;
+
+    paged_list_resize(list, index + 1);
+    memcpy(paged_list_get(list, index), item, list->item_size);
+
+    return index;
+}
+
+// Bytes of the page holding item index, from index to the end of the page
+// or of the list.
+static size_t page_span(Paged_List *list, size_t index) {
+    size_t count = list->len - index;
+    if (count > PAGED_LIST_PAGE_SIZE) {
+        count = PAGED_LIST_PAGE_SIZE;
+    }
+
+    return count * list->item_size;
+}
+
+// Copies every item into one contiguous block, a page at a time.
+void paged_list_copy_out(Paged_List *list, void *destination) {
+    for (size_t i = 0; i < list->len; i += PAGED_LIST_PAGE_SIZE) {
+        memcpy((u8*)destination + i * list->item_size, paged_list_get(list, i), page_span(list, i));
+    }
+}
+
+// Copies len items from one contiguous block over the items of the list.
+void paged_list_copy_in(Paged_List *list, const void *source) {
+    for (size_t i = 0; i < list->len; i += PAGED_LIST_PAGE_SIZE) {
+        memcpy(paged_list_get(list, i), (const u8*)source + i * list->item_size, page_span(list, i));
+    }
+}
@@ -4,10 +4,13 @@
 #include <linmath.h>
 
 #include "types.h"
+#include "array_list.h"
+#include "slot_map.h"
 
 typedef struct hit Hit;
 typedef struct body Body;
 typedef struct static_body Static_Body;
+typedef struct trigger Trigger;
 
 typedef void (*On_Hit)(Body *self, Body *other, Hit hit);
 typedef void (*On_Hit_Static)(Body *self, Static_Body *other, Hit hit);
@@ -21,13 +24,12 @@ typedef struct body {
     AABB aabb;
     vec2 velocity;
     vec2 acceleration;
-    On_Hit on_hit;
-    On_Hit_Static on_hit_static;
-    size_t entity_id;
+    Handle entity_id;
     u8 collision_layer;
     u8 collision_mask;
     bool is_kinematic;
     bool is_active;
+    bool is_sleeping;
 } Body;
 
 typedef struct static_body {
@@ -35,22 +37,68 @@ typedef struct static_body {
     u8 collision_layer;
 } Static_Body;
 
+typedef enum contact_state {
+    CONTACT_ENTER,
+    CONTACT_STAY,
+    CONTACT_EXIT,
+} Contact_State;
+
+// Triggers only report bodies entering or leaving them, contact is never
+// CONTACT_STAY.
+typedef void (*On_Trigger)(Trigger *self, Body *other, Contact_State contact);
+
+// Volume that reports the bodies selected by collision_mask overlapping it.
+// Nothing collides with it.
+typedef struct trigger {
+    AABB aabb;
+    u8 collision_mask;
+    bool is_active;
+} Trigger;
+
 typedef struct hit {
     size_t other_id;
     f32 time;
     vec2 position;
     vec2 normal;
     bool is_hit;
+    Contact_State contact;
 } Hit;
 
+// A body that was hit is in body_id, HANDLE_NONE otherwise. other_id of hit
+// is the static body index when is_static is set.
+typedef struct raycast_hit {
+    Hit hit;
+    Handle body_id;
+    bool is_static;
+} Raycast_Hit;
+
 void physics_init(void);
-void physics_update(void);
-Body *physics_body_get(size_t index);
-size_t physics_body_create(vec2 position, vec2 size, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static, size_t entity_id);
-size_t physics_trigger_create(vec2 position, vec2 size, u8 collision_layer, u8 collision_mask, On_Hit on_hit);
+u32 physics_update(f32 delta);
+void physics_step(void);
+void physics_step_rate_set(u32 step_rate, u32 max_steps);
+f32 physics_alpha(void);
+void physics_body_position_interpolated(vec2 result, Handle body_id);
+void physics_max_substeps_set(u32 max_substeps);
+void physics_lod_set(AABB region, u32 interval);
+void physics_sweep_and_prune_set(bool is_enabled);
+void physics_level_arena_set(Arena *arena);
+void physics_frame_arena_set(Arena *arena);
+u32 physics_substep_count(void);
+void physics_thread_count_set(u32 thread_count);
+Body *physics_body_get(Handle body_id);
+Handle physics_body_create(vec2 position, vec2 size, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static, Handle entity_id);
+void physics_body_reserve(size_t count);
+void physics_body_create_batch(Handle *body_ids, vec2 *positions, size_t count, vec2 size, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static, Handle *entity_ids);
+void physics_body_destroy(Handle body_id);
+Handle physics_body_handle(size_t index);
+void physics_body_wake(Handle body_id);
+size_t physics_trigger_create(vec2 position, vec2 size, u8 collision_mask, On_Trigger on_trigger);
+Trigger *physics_trigger_get(size_t index);
 Static_Body *physics_static_body_get(size_t index);
 size_t physics_static_body_create(vec2 position, vec2 size, u8 collision_layer);
+void physics_static_body_set(size_t index, vec2 position, vec2 size);
 size_t physics_static_body_count();
+size_t physics_static_body_coalesce(void);
 bool physics_point_intersect_aabb(vec2 point, AABB aabb);
 bool physics_aabb_intersect_aabb(AABB a, AABB b);
 AABB aabb_minkowski_difference(AABB a, AABB b);
@@ -58,3 +106,15 @@ void aabb_penetration_vector(vec2 r, AABB aabb);
 void aabb_min_max(vec2 min, vec2 max, AABB aabb);
 Hit ray_intersect_aabb(vec2 position, vec2 magnitude, AABB aabb);
 void physics_reset(void);
+size_t physics_snapshot_save(Array_List *snapshot);
+void physics_snapshot_restore(const void *snapshot);
+size_t physics_snapshot_save_delta(Array_List *delta, const void *base);
+void physics_snapshot_restore_delta(const void *delta, const void *base);
+size_t physics_snapshot_size(const void *snapshot);
+u64 physics_state_hash(void);
+Raycast_Hit physics_raycast(vec2 origin, vec2 magnitude, u8 collision_mask);
+size_t physics_overlap_aabb(AABB aabb, u8 collision_mask, Array_List *result_list);
+Handle physics_query_nearest(vec2 point, f32 max_distance, u8 collision_mask);
+void physics_raycast_batch(u32 count, vec2 *origins, vec2 *magnitudes, u8 collision_mask, Raycast_Hit *results);
+void physics_overlap_aabb_batch(u32 count, AABB *aabbs, u8 collision_mask, Array_List *result_list, u32 *result_counts);
+void physics_query_nearest_batch(u32 count, vec2 *points, f32 max_distance, u8 collision_mask, Handle *results);
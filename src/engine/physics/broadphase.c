@@ -0,0 +1,193 @@
+#include <math.h>
+#include <string.h>
+
+#include <linmath.h>
+
+#include "../util.h"
+#include "physics_internal.h"
+
+static i32 cell_coordinate(Broadphase_Grid *grid, f32 value) {
+    return (i32)floorf(value / grid->cell_size);
+}
+
+static u32 cell_bucket(Broadphase_Grid *grid, i32 x, i32 y, u32 layer_bit) {
+    return (((u32)x * 73856093u ^ (u32)y * 19349663u) * PHYSICS_LAYER_COUNT + layer_bit) & (grid->bucket_count - 1);
+}
+
+void broadphase_grid_init(Broadphase_Grid *grid, f32 cell_size) {
+    *grid = (Broadphase_Grid){
+        .cell_size = cell_size,
+        .bucket_start_list = array_list_create(sizeof(u32), 0),
+        .entry_list = array_list_create(sizeof(Broadphase_Entry), 0),
+        .cell_body_list = array_list_create(sizeof(u32), 0),
+        .bounds_list = array_list_create(sizeof(vec4), 0),
+        .overflow_list = array_list_create(sizeof(u32), 0),
+    };
+}
+
+void broadphase_grid_begin(Broadphase_Grid *grid, u32 body_count) {
+    grid->entry_list->len = 0;
+    grid->overflow_list->len = 0;
+    grid->body_count = body_count;
+
+    // Bodies that are never inserted must never count as escaped.
+    physics_list_resize(grid->bounds_list, body_count);
+    vec4 *bounds = grid->bounds_list->items;
+    for (u32 i = 0; i < body_count; i++) {
+        bounds[i][0] = -INFINITY;
+        bounds[i][1] = -INFINITY;
+        bounds[i][2] = INFINITY;
+        bounds[i][3] = INFINITY;
+    }
+}
+
+// A body is entered once per bit of its collision layer.
+void broadphase_grid_insert(Broadphase_Grid *grid, u32 body_id, u8 collision_layer, f32 *min, f32 *max) {
+    vec4 *bounds = grid->bounds_list->items;
+    bounds[body_id][0] = min[0];
+    bounds[body_id][1] = min[1];
+    bounds[body_id][2] = max[0];
+    bounds[body_id][3] = max[1];
+
+    i32 x0 = cell_coordinate(grid, min[0]);
+    i32 y0 = cell_coordinate(grid, min[1]);
+    i32 x1 = cell_coordinate(grid, max[0]);
+    i32 y1 = cell_coordinate(grid, max[1]);
+
+    for (u32 layer_bit = 0; layer_bit < PHYSICS_LAYER_COUNT; layer_bit++) {
+        if ((collision_layer & (1 << layer_bit)) == 0) {
+            continue;
+        }
+
+        for (i32 y = y0; y <= y1; y++) {
+            for (i32 x = x0; x <= x1; x++) {
+                broadphase_entry_list_append(grid->entry_list, (Broadphase_Entry){.x = x, .y = y, .body_id = body_id, .layer_bit = layer_bit});
+            }
+        }
+    }
+}
+
+void broadphase_grid_end(Broadphase_Grid *grid) {
+    Broadphase_Entry *entries = grid->entry_list->items;
+    size_t entry_count = grid->entry_list->len;
+
+    grid->bucket_count = BROADPHASE_MIN_BUCKET_COUNT;
+    while (grid->bucket_count < entry_count * 2) {
+        grid->bucket_count *= 2;
+    }
+
+    // Counting sort the entries by bucket.
+    physics_list_resize(grid->bucket_start_list, grid->bucket_count + 1);
+    u32 *bucket_start = grid->bucket_start_list->items;
+    memset(bucket_start, 0, (grid->bucket_count + 1) * sizeof(u32));
+
+    for (size_t i = 0; i < entry_count; i++) {
+        bucket_start[cell_bucket(grid, entries[i].x, entries[i].y, entries[i].layer_bit) + 1]++;
+    }
+
+    for (u32 i = 0; i < grid->bucket_count; i++) {
+        bucket_start[i + 1] += bucket_start[i];
+    }
+
+    physics_list_resize(grid->cell_body_list, entry_count);
+    u32 *cell_bodies = grid->cell_body_list->items;
+    for (size_t i = entry_count; i > 0; i--) {
+        Broadphase_Entry *entry = &entries[i - 1];
+        cell_bodies[--bucket_start[cell_bucket(grid, entry->x, entry->y, entry->layer_bit) + 1]] = entry->body_id;
+    }
+
+    // The fill above walked every bucket start back to the previous bucket.
+    memmove(bucket_start, bucket_start + 1, grid->bucket_count * sizeof(u32));
+    bucket_start[grid->bucket_count] = (u32)entry_count;
+}
+
+// Called after a body has moved. Once it has left the bounds it was inserted
+// with, the cells no longer describe it.
+void broadphase_grid_update(Broadphase_Grid *grid, u32 body_id, f32 *min, f32 *max) {
+    if (body_id >= grid->body_count) {
+        return;
+    }
+
+    f32 *bounds = ((vec4*)grid->bounds_list->items)[body_id];
+    if (min[0] >= bounds[0] && min[1] >= bounds[1] && max[0] <= bounds[2] && max[1] <= bounds[3]) {
+        return;
+    }
+
+    // Mark as escaped so it is only appended once.
+    bounds[0] = bounds[1] = -INFINITY;
+    bounds[2] = bounds[3] = INFINITY;
+
+    u32_list_append(grid->overflow_list, body_id);
+}
+
+static void query_body(Broadphase_Query *query, u32 body_id, u32 *stamps, Array_List *candidate_list) {
+    if (stamps[body_id] != query->stamp) {
+        stamps[body_id] = query->stamp;
+        u32_list_append(candidate_list, body_id);
+    }
+}
+
+static void query_bucket(Broadphase_Grid *grid, Broadphase_Query *query, u32 bucket, u32 *stamps, Array_List *candidate_list) {
+    u32 *bucket_start = grid->bucket_start_list->items;
+    u32 *cell_bodies = grid->cell_body_list->items;
+
+    for (u32 i = bucket_start[bucket]; i < bucket_start[bucket + 1]; i++) {
+        query_body(query, cell_bodies[i], stamps, candidate_list);
+    }
+}
+
+// Appends every body that may overlap min/max and whose layer may match
+// collision_mask to candidate_list in ascending id order, so results match a
+// linear scan. Callers still have to check the mask, buckets are shared by
+// hash collisions. Escaped bodies and bodies created after the grid was
+// built are always included.
+void broadphase_grid_query(Broadphase_Grid *grid, Broadphase_Query *query, u8 collision_mask, f32 *min, f32 *max, u32 body_count, Array_List *candidate_list) {
+    candidate_list->len = 0;
+
+    if (query->stamp_list->len < grid->body_count) {
+        size_t len = query->stamp_list->len;
+        physics_list_resize(query->stamp_list, grid->body_count);
+        memset((u32*)query->stamp_list->items + len, 0, (grid->body_count - len) * sizeof(u32));
+    }
+
+    u32 *stamps = query->stamp_list->items;
+
+    if (++query->stamp == 0) {
+        memset(stamps, 0, query->stamp_list->len * sizeof(u32));
+        query->stamp = 1;
+    }
+
+    i32 x0 = cell_coordinate(grid, min[0]);
+    i32 y0 = cell_coordinate(grid, min[1]);
+    i32 x1 = cell_coordinate(grid, max[0]);
+    i32 y1 = cell_coordinate(grid, max[1]);
+
+    if ((u64)(x1 - x0 + 1) * (u64)(y1 - y0 + 1) > grid->bucket_count) {
+        for (u32 bucket = 0; bucket < grid->bucket_count; bucket++) {
+            query_bucket(grid, query, bucket, stamps, candidate_list);
+        }
+    } else {
+        for (u32 layer_bit = 0; layer_bit < PHYSICS_LAYER_COUNT; layer_bit++) {
+            if ((collision_mask & (1 << layer_bit)) == 0) {
+                continue;
+            }
+
+            for (i32 y = y0; y <= y1; y++) {
+                for (i32 x = x0; x <= x1; x++) {
+                    query_bucket(grid, query, cell_bucket(grid, x, y, layer_bit), stamps, candidate_list);
+                }
+            }
+        }
+    }
+
+    u32 *overflow = grid->overflow_list->items;
+    for (size_t i = 0; i < grid->overflow_list->len; i++) {
+        query_body(query, overflow[i], stamps, candidate_list);
+    }
+
+    physics_sort_ids(candidate_list);
+
+    for (u32 body_id = grid->body_count; body_id < body_count; body_id++) {
+        u32_list_append(candidate_list, body_id);
+    }
+}
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <linmath.h>
+
+#include "../util.h"
+#include "../physics.h"
+#include "physics_internal.h"
+
+#define BVH_LEAF_SIZE 4
+// Every child holds at most three quarters of its parent, so the depth stays
+// below this for any tree that fits in memory.
+#define BVH_STACK_SIZE 64
+
+static bool bounds_touch(f32 *a_min, f32 *a_max, f32 *b_min, f32 *b_max) {
+    return a_min[0] <= b_max[0] && a_max[0] >= b_min[0] && a_min[1] <= b_max[1] && a_max[1] >= b_min[1];
+}
+
+void bvh_init(Bvh *bvh, u32 layer) {
+    *bvh = (Bvh){
+        .node_list = array_list_create(sizeof(Bvh_Node), 0),
+        .item_list = array_list_create(sizeof(Bvh_Item), 0),
+        .layer = layer,
+        .is_dirty = true,
+    };
+}
+
+static bool bvh_has(Bvh *bvh, u8 collision_layer) {
+    if (bvh->layer == STATIC_TREE_LAYERLESS) {
+        return collision_layer == 0;
+    }
+
+    return (collision_layer & (1 << bvh->layer)) != 0;
+}
+
+static int item_compare_x(const void *a, const void *b) {
+    f32 a_centroid = ((Bvh_Item*)a)->min[0] + ((Bvh_Item*)a)->max[0];
+    f32 b_centroid = ((Bvh_Item*)b)->min[0] + ((Bvh_Item*)b)->max[0];
+    return (a_centroid > b_centroid) - (a_centroid < b_centroid);
+}
+
+static int item_compare_y(const void *a, const void *b) {
+    f32 a_centroid = ((Bvh_Item*)a)->min[1] + ((Bvh_Item*)a)->max[1];
+    f32 b_centroid = ((Bvh_Item*)b)->min[1] + ((Bvh_Item*)b)->max[1];
+    return (a_centroid > b_centroid) - (a_centroid < b_centroid);
+}
+
+static void build_node(Bvh *bvh, u32 node_index, u32 first, u32 count) {
+    Bvh_Item *items = bvh->item_list->items;
+    vec2 min = {INFINITY, INFINITY};
+    vec2 max = {-INFINITY, -INFINITY};
+    vec2 centroid_min = {INFINITY, INFINITY};
+    vec2 centroid_max = {-INFINITY, -INFINITY};
+
+    for (u32 i = first; i < first + count; i++) {
+        for (u8 axis = 0; axis < 2; axis++) {
+            f32 centroid = (items[i].min[axis] + items[i].max[axis]) * 0.5f;
+            min[axis] = fminf(min[axis], items[i].min[axis]);
+            max[axis] = fmaxf(max[axis], items[i].max[axis]);
+            centroid_min[axis] = fminf(centroid_min[axis], centroid);
+            centroid_max[axis] = fmaxf(centroid_max[axis], centroid);
+        }
+    }
+
+    Bvh_Node *node = (Bvh_Node*)bvh->node_list->items + node_index;
+    *node = (Bvh_Node){
+        .min = {min[0], min[1]},
+        .max = {max[0], max[1]},
+        .first = first,
+        .count = count,
+    };
+
+    if (count <= BVH_LEAF_SIZE) {
+        return;
+    }
+
+    // Split at the middle of the widest centroid extent.
+    u8 axis = centroid_max[0] - centroid_min[0] >= centroid_max[1] - centroid_min[1] ? 0 : 1;
+    f32 split = (centroid_min[axis] + centroid_max[axis]) * 0.5f;
+
+    u32 middle = first;
+    for (u32 i = first; i < first + count; i++) {
+        if ((items[i].min[axis] + items[i].max[axis]) * 0.5f < split) {
+            Bvh_Item tmp = items[i];
+            items[i] = items[middle];
+            items[middle] = tmp;
+            middle++;
+        }
+    }
+
+    // Bodies spaced further and further apart would leave only a few on one
+    // side every time and grow a chain instead of a tree. When a side gets
+    // less than a quarter, split at the median instead.
+    u32 smaller = middle - first < first + count - middle ? middle - first : first + count - middle;
+    if (smaller < count / 4) {
+        qsort(items + first, count, sizeof(Bvh_Item), axis == 0 ? item_compare_x : item_compare_y);
+        middle = first + count / 2;
+    }
+
+    u32 left = bvh->node_list->len;
+    physics_list_resize(bvh->node_list, left + 2);
+
+    node = (Bvh_Node*)bvh->node_list->items + node_index;
+    node->first = left;
+    node->count = 0;
+
+    build_node(bvh, left, first, middle - first);
+    build_node(bvh, left + 1, middle, first + count - middle);
+}
+
+void bvh_build(Bvh *bvh, Array_List *static_body_list) {
+    u32 count = 0;
+
+    physics_list_resize(bvh->item_list, static_body_list->len);
+    Bvh_Item *items = bvh->item_list->items;
+    for (u32 i = 0; i < static_body_list->len; i++) {
+        Static_Body *static_body = (Static_Body*)static_body_list->items + i;
+
+        if (!bvh_has(bvh, static_body->collision_layer)) {
+            continue;
+        }
+
+        items[count].id = i;
+        aabb_min_max(items[count].min, items[count].max, static_body->aabb);
+        count++;
+    }
+
+    bvh->item_list->len = count;
+
+    physics_list_resize(bvh->node_list, 1);
+    build_node(bvh, 0, 0, count);
+
+    bvh->is_dirty = false;
+}
+
+// Appends the id of every static body touching min/max to candidate_list.
+void bvh_query(Bvh *bvh, f32 *min, f32 *max, Array_List *candidate_list) {
+    if (bvh->item_list->len == 0) {
+        return;
+    }
+
+    Bvh_Node *nodes = bvh->node_list->items;
+    Bvh_Item *items = bvh->item_list->items;
+    u32 stack[BVH_STACK_SIZE];
+    u32 stack_len = 0;
+    stack[stack_len++] = 0;
+
+    while (stack_len > 0) {
+        Bvh_Node *node = &nodes[stack[--stack_len]];
+
+        if (!bounds_touch(node->min, node->max, min, max)) {
+            continue;
+        }
+
+        if (node->count == 0) {
+            if (stack_len + 2 > BVH_STACK_SIZE) {
+                ERROR_EXIT("BVH query stack overflow\n");
+            }
+
+            stack[stack_len++] = node->first;
+            stack[stack_len++] = node->first + 1;
+            continue;
+        }
+
+        for (u32 i = node->first; i < node->first + node->count; i++) {
+            if (bounds_touch(items[i].min, items[i].max, min, max)) {
+                u32_list_append(candidate_list, items[i].id);
+            }
+        }
+    }
+}
@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <linmath.h>
+
+#include "../util.h"
+#include "../physics.h"
+#include "physics_internal.h"
+
+// Static bodies are merged as spans. Those left unmerged keep their
+// original AABB, so they aren't rounded through min and max. A span keeps
+// the lowest index of the static bodies it covers.
+typedef struct static_span {
+    AABB aabb;
+    vec2 min;
+    vec2 max;
+    u32 index;
+    u8 collision_layer;
+    bool is_merged;
+    bool is_removed;
+} Static_Span;
+
+// Orders by layer, then by the extent across axis, then along it, so spans
+// that can be joined along axis end up next to each other.
+static i32 span_compare(const Static_Span *a, const Static_Span *b, u8 axis) {
+    u8 across = 1 - axis;
+
+    if (a->collision_layer != b->collision_layer) {
+        return a->collision_layer < b->collision_layer ? -1 : 1;
+    }
+
+    f32 keys_a[] = {a->min[across], a->max[across], a->min[axis]};
+    f32 keys_b[] = {b->min[across], b->max[across], b->min[axis]};
+
+    for (u8 i = 0; i < 3; i++) {
+        if (keys_a[i] != keys_b[i]) {
+            return keys_a[i] < keys_b[i] ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+static i32 span_row_compare(const void *a, const void *b) {
+    return span_compare(a, b, 0);
+}
+
+static i32 span_column_compare(const void *a, const void *b) {
+    return span_compare(a, b, 1);
+}
+
+// Orders by layer and left edge, widest first, so a span always comes
+// before the spans it contains.
+static i32 span_containment_compare(const void *a, const void *b) {
+    const Static_Span *span_a = a;
+    const Static_Span *span_b = b;
+
+    if (span_a->collision_layer != span_b->collision_layer) {
+        return span_a->collision_layer < span_b->collision_layer ? -1 : 1;
+    }
+
+    if (span_a->min[0] != span_b->min[0]) {
+        return span_a->min[0] < span_b->min[0] ? -1 : 1;
+    }
+
+    return (span_a->max[0] < span_b->max[0]) - (span_a->max[0] > span_b->max[0]);
+}
+
+static i32 span_index_compare(const void *a, const void *b) {
+    const Static_Span *span_a = a;
+    const Static_Span *span_b = b;
+
+    return (span_a->index > span_b->index) - (span_a->index < span_b->index);
+}
+
+// Records that the span with index absorbed was merged into the one with
+// index into. Owners always point at a span that is still there.
+static void span_absorb(u32 *owners, Static_Span *into, u32 absorbed) {
+    if (absorbed < into->index) {
+        owners[into->index] = absorbed;
+        into->index = absorbed;
+    } else {
+        owners[absorbed] = into->index;
+    }
+}
+
+// Joins spans of the same layer that cover the same extent across axis and
+// touch or overlap along it. Their union is exactly the merged box.
+static size_t spans_join(Static_Span *spans, size_t count, u32 *owners, u8 axis) {
+    if (count == 0) {
+        return 0;
+    }
+
+    qsort(spans, count, sizeof(Static_Span), axis == 0 ? span_row_compare : span_column_compare);
+
+    u8 across = 1 - axis;
+    size_t joined = 0;
+
+    for (size_t i = 1; i < count; i++) {
+        Static_Span *last = &spans[joined];
+        Static_Span *span = &spans[i];
+
+        if (span->collision_layer == last->collision_layer &&
+            span->min[across] == last->min[across] &&
+            span->max[across] == last->max[across] &&
+            span->min[axis] <= last->max[axis]) {
+            if (span->max[axis] > last->max[axis]) {
+                last->max[axis] = span->max[axis];
+            }
+            last->is_merged = true;
+            span_absorb(owners, last, span->index);
+        } else {
+            spans[++joined] = *span;
+        }
+    }
+
+    return joined + 1;
+}
+
+// Drops spans that lie entirely inside another span of the same layer.
+static size_t spans_drop_contained(Static_Span *spans, size_t count, u32 *owners) {
+    qsort(spans, count, sizeof(Static_Span), span_containment_compare);
+
+    for (size_t i = 0; i < count; i++) {
+        Static_Span *outer = &spans[i];
+
+        if (outer->is_removed) {
+            continue;
+        }
+
+        for (size_t j = i + 1; j < count; j++) {
+            Static_Span *inner = &spans[j];
+
+            if (inner->collision_layer != outer->collision_layer || inner->min[0] > outer->max[0]) {
+                break;
+            }
+
+            if (inner->max[0] <= outer->max[0] &&
+                inner->min[1] >= outer->min[1] &&
+                inner->max[1] <= outer->max[1]) {
+                inner->is_removed = true;
+                span_absorb(owners, outer, inner->index);
+            }
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!spans[i].is_removed) {
+            spans[kept++] = spans[i];
+        }
+    }
+
+    return kept;
+}
+
+// Replaces the static bodies with a smaller set covering exactly the same
+// area on every layer. Boxes are only merged when their union is itself a
+// box, so nothing that collided before stops colliding and nothing new
+// does, and floors built from tiles lose the seams between them. Overlapping
+// boxes that don't form a box together are left as they are.
+//
+// The list is compacted in place: a merged box takes the index of the first
+// static body it covers, and the others only shift down past the entries
+// that were merged away. remap must hold one entry per static body and is
+// set to the new index of the box that covers it. The spans are scratch
+// memory from arena.
+size_t static_bodies_coalesce(Array_List *static_body_list, u32 *remap, Arena *arena) {
+    size_t original_count = static_body_list->len;
+    size_t count = original_count;
+    if (count == 0) {
+        return 0;
+    }
+
+    Static_Span *spans = arena_alloc(arena, count * sizeof(Static_Span));
+    u32 *owners = arena_alloc(arena, count * sizeof(u32));
+
+    Static_Body *static_bodies = static_body_list->items;
+    for (size_t i = 0; i < count; i++) {
+        spans[i] = (Static_Span){
+            .aabb = static_bodies[i].aabb,
+            .index = i,
+            .collision_layer = static_bodies[i].collision_layer,
+        };
+        aabb_min_max(spans[i].min, spans[i].max, static_bodies[i].aabb);
+        owners[i] = i;
+    }
+
+    // Joining rows can line up columns and the other way around, so keep
+    // going until nothing changes.
+    for (;;) {
+        size_t previous_count = count;
+
+        count = spans_join(spans, count, owners, 0);
+        count = spans_join(spans, count, owners, 1);
+        count = spans_drop_contained(spans, count, owners);
+
+        if (count == previous_count) {
+            break;
+        }
+    }
+
+    qsort(spans, count, sizeof(Static_Span), span_index_compare);
+
+    for (size_t i = 0; i < count; i++) {
+        Static_Span *span = &spans[i];
+        remap[span->index] = i;
+
+        if (span->is_merged) {
+            span->aabb = (AABB){
+                .position = { (span->min[0] + span->max[0]) * 0.5f, (span->min[1] + span->max[1]) * 0.5f },
+                .half_size = { (span->max[0] - span->min[0]) * 0.5f, (span->max[1] - span->min[1]) * 0.5f },
+            };
+        }
+
+        static_bodies[i] = (Static_Body){.aabb = span->aabb, .collision_layer = span->collision_layer};
+    }
+
+    static_body_list->len = count;
+
+    for (size_t i = 0; i < original_count; i++) {
+        u32 owner = i;
+        while (owners[owner] != owner) {
+            owner = owners[owner];
+        }
+        owners[i] = owner;
+        remap[i] = remap[owner];
+    }
+
+    return count;
+}
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+
+#include "../util.h"
+#include "physics_internal.h"
+
+static i32 pair_compare(const Contact *a, const Contact *b) {
+    if (a->body_id != b->body_id) {
+        return a->body_id < b->body_id ? -1 : 1;
+    }
+
+    if (a->kind != b->kind) {
+        return a->kind < b->kind ? -1 : 1;
+    }
+
+    if (a->other_id != b->other_id) {
+        return a->other_id < b->other_id ? -1 : 1;
+    }
+
+    return 0;
+}
+
+// Orders by pair, then by when the contact was found so the first contact of
+// a pair in a step is the one kept.
+static i32 contact_compare(const void *a, const void *b) {
+    const Contact *contact_a = a;
+    const Contact *contact_b = b;
+    i32 order = pair_compare(contact_a, contact_b);
+
+    if (order != 0) {
+        return order;
+    }
+
+    return (contact_a->sequence > contact_b->sequence) - (contact_a->sequence < contact_b->sequence);
+}
+
+void contact_cache_init(Contact_Cache *cache) {
+    *cache = (Contact_Cache){
+        .pair_list = array_list_create(sizeof(Contact), 0),
+        .next_pair_list = array_list_create(sizeof(Contact), 0),
+        .event_list = array_list_create(sizeof(Contact), 0),
+    };
+}
+
+void contact_cache_reset(Contact_Cache *cache) {
+    cache->pair_list->len = 0;
+    cache->next_pair_list->len = 0;
+    cache->event_list->len = 0;
+}
+
+// Drops every pair the body is part of.
+void contact_cache_remove_body(Contact_Cache *cache, u32 body_id) {
+    Contact *pairs = cache->pair_list->items;
+    size_t count = 0;
+
+    for (size_t i = 0; i < cache->pair_list->len; i++) {
+        if (pairs[i].body_id != body_id && !(pairs[i].kind == CONTACT_KIND_BODY && pairs[i].other_id == body_id)) {
+            pairs[count++] = pairs[i];
+        }
+    }
+
+    cache->pair_list->len = count;
+}
+
+// Moves pairs with a static body to the static body's new index, for when
+// static bodies are merged. A body touching several boxes that became one
+// keeps a single pair, so it doesn't see the merged box as new.
+void contact_cache_remap_statics(Contact_Cache *cache, const u32 *remap) {
+    Contact *pairs = cache->pair_list->items;
+
+    for (size_t i = 0; i < cache->pair_list->len; i++) {
+        if (pairs[i].kind == CONTACT_KIND_STATIC) {
+            pairs[i].other_id = remap[pairs[i].other_id];
+            pairs[i].hit.other_id = pairs[i].other_id;
+        }
+    }
+
+    qsort(pairs, cache->pair_list->len, sizeof(Contact), contact_compare);
+
+    size_t count = 0;
+    for (size_t i = 0; i < cache->pair_list->len; i++) {
+        if (count == 0 || pair_compare(&pairs[count - 1], &pairs[i]) != 0) {
+            pairs[count++] = pairs[i];
+        }
+    }
+
+    cache->pair_list->len = count;
+}
+
+void contact_cache_begin(Contact_Cache *cache) {
+    cache->next_pair_list->len = 0;
+    cache->event_list->len = 0;
+}
+
+static void pair_append(Contact_Cache *cache, Contact *contact) {
+    u32 sequence = (u32)cache->next_pair_list->len;
+    Contact *pair = contact_list_emplace(cache->next_pair_list);
+    *pair = *contact;
+    pair->sequence = sequence;
+}
+
+// Adds the contacts found by one thread. Threads must be added in order.
+void contact_cache_add(Contact_Cache *cache, Array_List *contact_list) {
+    Contact *contacts = contact_list->items;
+
+    for (size_t i = 0; i < contact_list->len; i++) {
+        pair_append(cache, &contacts[i]);
+    }
+}
+
+static void event_append(Contact_Cache *cache, Contact *contact, Contact_State contact_state) {
+    Contact *event = contact_list_emplace(cache->event_list);
+    *event = *contact;
+    event->hit.contact = contact_state;
+}
+
+static bool body_is(Paged_List *body_list, const u8 *is_integrated, u32 body_id, bool is_stepped) {
+    if (body_id >= body_list->len) {
+        return false;
+    }
+
+    Body *body = paged_list_get(body_list, body_id);
+    return body->is_active && (is_integrated[body_id] != 0) == is_stepped;
+}
+
+// Compares the pairs of this step with those of the previous one and
+// appends enter, stay and exit events in pair order. Pairs of bodies that
+// weren't stepped, because they sleep or were left for a later step, are
+// kept without events until the body is stepped again.
+void contact_cache_end(Contact_Cache *cache, Paged_List *body_list, const u8 *is_integrated) {
+    Contact *pairs = cache->pair_list->items;
+
+    for (size_t i = 0; i < cache->pair_list->len; i++) {
+        if (body_is(body_list, is_integrated, pairs[i].body_id, false)) {
+            Contact kept = pairs[i];
+            kept.is_kept = true;
+            pair_append(cache, &kept);
+        }
+    }
+
+    qsort(cache->next_pair_list->items, cache->next_pair_list->len, sizeof(Contact), contact_compare);
+
+    Contact *next_pairs = cache->next_pair_list->items;
+    size_t next_count = 0;
+
+    for (size_t i = 0; i < cache->next_pair_list->len; i++) {
+        if (next_count == 0 || pair_compare(&next_pairs[next_count - 1], &next_pairs[i]) != 0) {
+            next_pairs[next_count++] = next_pairs[i];
+        }
+    }
+
+    cache->next_pair_list->len = next_count;
+
+    size_t pair_count = cache->pair_list->len;
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < pair_count || j < next_count) {
+        i32 order = i == pair_count ? 1 : j == next_count ? -1 : pair_compare(&pairs[i], &next_pairs[j]);
+
+        if (order < 0) {
+            // Bodies that are gone have nothing left to notify.
+            if (body_is(body_list, is_integrated, pairs[i].body_id, true)) {
+                event_append(cache, &pairs[i], CONTACT_EXIT);
+            }
+            i++;
+        } else if (order > 0) {
+            event_append(cache, &next_pairs[j], CONTACT_ENTER);
+            j++;
+        } else {
+            if (!next_pairs[j].is_kept) {
+                event_append(cache, &next_pairs[j], CONTACT_STAY);
+            }
+            next_pairs[j].is_kept = false;
+            i++;
+            j++;
+        }
+    }
+
+    Array_List *pair_list = cache->pair_list;
+    cache->pair_list = cache->next_pair_list;
+    cache->next_pair_list = pair_list;
+}
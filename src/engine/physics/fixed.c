@@ -0,0 +1,202 @@
+#ifdef PHYSICS_FIXED_POINT
+
+#include <linmath.h>
+
+#include "../physics.h"
+#include "physics_internal.h"
+
+// Fixed point build of the AABB functions in physics.c. Every result is
+// worked out on integers and converted back to f32 once at the end. What is
+// left in f32 elsewhere are single adds and compares, which IEEE rounds the
+// same everywhere.
+
+typedef struct fixed_aabb {
+    Fixed position[2];
+    Fixed half_size[2];
+} Fixed_AABB;
+
+static void fixed_vec2(Fixed result[2], vec2 v) {
+    result[0] = fixed_from_f32(v[0]);
+    result[1] = fixed_from_f32(v[1]);
+}
+
+static Fixed_AABB fixed_aabb(AABB aabb) {
+    Fixed_AABB result;
+    fixed_vec2(result.position, aabb.position);
+    fixed_vec2(result.half_size, aabb.half_size);
+
+    return result;
+}
+
+static void fixed_min_max(Fixed min[2], Fixed max[2], Fixed_AABB aabb) {
+    for (u8 i = 0; i < 2; i++) {
+        min[i] = fixed_clamp((i64)aabb.position[i] - aabb.half_size[i]);
+        max[i] = fixed_clamp((i64)aabb.position[i] + aabb.half_size[i]);
+    }
+}
+
+static Fixed fixed_min(Fixed a, Fixed b) {
+    return a < b ? a : b;
+}
+
+static Fixed fixed_max(Fixed a, Fixed b) {
+    return a > b ? a : b;
+}
+
+static Fixed fixed_abs(Fixed value) {
+    return value < 0 ? -value : value;
+}
+
+static i32 fixed_sign(i64 value) {
+    return (value > 0) - (value < 0);
+}
+
+void aabb_min_max(vec2 min, vec2 max, AABB aabb) {
+    Fixed box_min[2], box_max[2];
+    fixed_min_max(box_min, box_max, fixed_aabb(aabb));
+
+    for (u8 i = 0; i < 2; i++) {
+        min[i] = fixed_to_f32(box_min[i]);
+        max[i] = fixed_to_f32(box_max[i]);
+    }
+}
+
+AABB aabb_minkowski_difference(AABB a, AABB b) {
+    Fixed_AABB fixed_a = fixed_aabb(a);
+    Fixed_AABB fixed_b = fixed_aabb(b);
+    AABB result;
+
+    for (u8 i = 0; i < 2; i++) {
+        result.position[i] = fixed_to_f32(fixed_clamp((i64)fixed_a.position[i] - fixed_b.position[i]));
+        result.half_size[i] = fixed_to_f32(fixed_clamp((i64)fixed_a.half_size[i] + fixed_b.half_size[i]));
+    }
+
+    return result;
+}
+
+// Time at which a ray from pos along magnitude enters aabb, if it does so
+// before the end of the ray. Shared with the batched sweep.
+bool fixed_ray_entry(vec2 pos, vec2 magnitude, AABB aabb, Fixed *entry_time) {
+    Fixed fixed_pos[2], fixed_magnitude[2], min[2], max[2];
+    fixed_vec2(fixed_pos, pos);
+    fixed_vec2(fixed_magnitude, magnitude);
+    fixed_min_max(min, max, fixed_aabb(aabb));
+
+    Fixed last_entry = FIXED_MIN;
+    Fixed first_exit = FIXED_MAX;
+
+    for (u8 i = 0; i < 2; i++) {
+        if (fixed_magnitude[i] != 0) {
+            Fixed t1 = fixed_div((i64)min[i] - fixed_pos[i], fixed_magnitude[i]);
+            Fixed t2 = fixed_div((i64)max[i] - fixed_pos[i], fixed_magnitude[i]);
+
+            last_entry = fixed_max(last_entry, fixed_min(t1, t2));
+            first_exit = fixed_min(first_exit, fixed_max(t1, t2));
+        } else if (fixed_pos[i] <= min[i] || fixed_pos[i] >= max[i]) {
+            return false;
+        }
+    }
+
+    *entry_time = last_entry;
+    return first_exit > last_entry && first_exit > 0 && last_entry < FIXED_ONE;
+}
+
+static Hit fixed_hit_at(vec2 pos, vec2 magnitude, AABB aabb, Fixed time) {
+    Fixed fixed_pos[2], fixed_magnitude[2];
+    fixed_vec2(fixed_pos, pos);
+    fixed_vec2(fixed_magnitude, magnitude);
+    Fixed_AABB box = fixed_aabb(aabb);
+    Hit hit = {0};
+
+    Fixed position[2];
+    for (u8 i = 0; i < 2; i++) {
+        position[i] = fixed_clamp((i64)fixed_pos[i] + fixed_mul(fixed_magnitude[i], time));
+        hit.position[i] = fixed_to_f32(position[i]);
+    }
+
+    hit.is_hit = true;
+    hit.time = fixed_to_f32(time);
+
+    i64 dx = (i64)position[0] - box.position[0];
+    i64 dy = (i64)position[1] - box.position[1];
+    i64 px = box.half_size[0] - (dx < 0 ? -dx : dx);
+    i64 py = box.half_size[1] - (dy < 0 ? -dy : dy);
+
+    if (px < py) {
+        hit.normal[0] = fixed_sign(dx);
+    } else {
+        hit.normal[1] = fixed_sign(dy);
+    }
+
+    return hit;
+}
+
+Hit ray_intersect_aabb(vec2 pos, vec2 magnitude, AABB aabb) {
+    Fixed entry_time;
+
+    if (!fixed_ray_entry(pos, magnitude, aabb, &entry_time)) {
+        return (Hit){0};
+    }
+
+    return fixed_hit_at(pos, magnitude, aabb, entry_time);
+}
+
+Hit ray_hit_at(vec2 pos, vec2 magnitude, AABB aabb, f32 time) {
+    return fixed_hit_at(pos, magnitude, aabb, fixed_from_f32(time));
+}
+
+bool physics_aabb_intersect_aabb(AABB a, AABB b) {
+    Fixed_AABB fixed_a = fixed_aabb(a);
+    Fixed_AABB fixed_b = fixed_aabb(b);
+
+    for (u8 i = 0; i < 2; i++) {
+        i64 distance = (i64)fixed_a.position[i] - fixed_b.position[i];
+        i64 reach = (i64)fixed_a.half_size[i] + fixed_b.half_size[i];
+
+        if (distance > reach || -distance > reach) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void aabb_penetration_vector(vec2 r, AABB aabb) {
+    Fixed min[2], max[2];
+    fixed_min_max(min, max, fixed_aabb(aabb));
+
+    Fixed min_dist = fixed_abs(min[0]);
+    Fixed result[2] = {min[0], 0};
+
+    if (fixed_abs(max[0]) < min_dist) {
+        min_dist = fixed_abs(max[0]);
+        result[0] = max[0];
+    }
+
+    if (fixed_abs(min[1]) < min_dist) {
+        min_dist = fixed_abs(min[1]);
+        result[0] = 0;
+        result[1] = min[1];
+    }
+
+    if (fixed_abs(max[1]) < min_dist) {
+        result[0] = 0;
+        result[1] = max[1];
+    }
+
+    r[0] = fixed_to_f32(result[0]);
+    r[1] = fixed_to_f32(result[1]);
+}
+
+bool physics_point_intersect_aabb(vec2 point, AABB aabb) {
+    Fixed fixed_point[2], min[2], max[2];
+    fixed_vec2(fixed_point, point);
+    fixed_min_max(min, max, fixed_aabb(aabb));
+
+    return fixed_point[0] >= min[0] &&
+           fixed_point[0] <= max[0] &&
+           fixed_point[1] >= min[1] &&
+           fixed_point[1] <= max[1];
+}
+
+#endif
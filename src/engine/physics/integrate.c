@@ -0,0 +1,192 @@
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PHYSICS_SSE
+#endif
+
+#include "../util.h"
+#include "../physics.h"
+#include "physics_internal.h"
+
+// Lanes are padded to a whole number of vectors.
+#define LANE_WIDTH 4
+
+static void *lane_resize(void *lane, size_t size) {
+    void *result = realloc(lane, size);
+    if (!result) {
+        ERROR_EXIT("Could not allocate memory for body lanes\n");
+    }
+
+    return result;
+}
+
+static void lanes_reserve(Body_Lanes *lanes, u32 count) {
+    if (count <= lanes->capacity) {
+        return;
+    }
+
+    u32 capacity = lanes->capacity > 0 ? lanes->capacity : LANE_WIDTH;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    lanes->velocity_x = lane_resize(lanes->velocity_x, capacity * sizeof(f32));
+    lanes->velocity_y = lane_resize(lanes->velocity_y, capacity * sizeof(f32));
+    lanes->acceleration_x = lane_resize(lanes->acceleration_x, capacity * sizeof(f32));
+    lanes->acceleration_y = lane_resize(lanes->acceleration_y, capacity * sizeof(f32));
+    lanes->step_x = lane_resize(lanes->step_x, capacity * sizeof(f32));
+    lanes->step_y = lane_resize(lanes->step_y, capacity * sizeof(f32));
+    lanes->step_weight = lane_resize(lanes->step_weight, capacity * sizeof(f32));
+    lanes->dynamic_mask = lane_resize(lanes->dynamic_mask, capacity * sizeof(u32));
+    lanes->substep_count = lane_resize(lanes->substep_count, capacity * sizeof(u32));
+    lanes->is_integrated = lane_resize(lanes->is_integrated, capacity * sizeof(u8));
+    lanes->capacity = capacity;
+}
+
+#if defined(PHYSICS_FIXED_POINT)
+static void integrate_lanes(Body_Lanes *lanes, u32 count, f32 gravity, f32 terminal_velocity, f32 scale) {
+    Fixed fixed_gravity = fixed_from_f32(gravity);
+    Fixed fixed_terminal_velocity = fixed_from_f32(terminal_velocity);
+    Fixed fixed_scale = fixed_from_f32(scale);
+
+    for (u32 i = 0; i < count; i++) {
+        Fixed vx = fixed_from_f32(lanes->velocity_x[i]);
+        Fixed vy = fixed_from_f32(lanes->velocity_y[i]);
+        i64 weight = (i64)lanes->step_weight[i];
+
+        if (lanes->dynamic_mask[i]) {
+            vy = fixed_clamp((i64)vy + fixed_gravity * weight);
+            if (fixed_terminal_velocity > vy) {
+                vy = fixed_terminal_velocity;
+            }
+        }
+
+        vx = fixed_clamp((i64)vx + fixed_from_f32(lanes->acceleration_x[i]) * weight);
+        vy = fixed_clamp((i64)vy + fixed_from_f32(lanes->acceleration_y[i]) * weight);
+
+        Fixed weighted_scale = fixed_clamp(fixed_scale * weight);
+
+        lanes->velocity_x[i] = fixed_to_f32(vx);
+        lanes->velocity_y[i] = fixed_to_f32(vy);
+        lanes->step_x[i] = fixed_to_f32(fixed_mul(vx, weighted_scale));
+        lanes->step_y[i] = fixed_to_f32(fixed_mul(vy, weighted_scale));
+    }
+}
+#elif defined(PHYSICS_SSE)
+static void integrate_lanes(Body_Lanes *lanes, u32 count, f32 gravity, f32 terminal_velocity, f32 scale) {
+    __m128 gravity_v = _mm_set1_ps(gravity);
+    __m128 terminal_velocity_v = _mm_set1_ps(terminal_velocity);
+    __m128 scale_v = _mm_set1_ps(scale);
+
+    for (u32 i = 0; i < count; i += LANE_WIDTH) {
+        __m128 vx = _mm_loadu_ps(lanes->velocity_x + i);
+        __m128 vy = _mm_loadu_ps(lanes->velocity_y + i);
+        __m128 weight = _mm_loadu_ps(lanes->step_weight + i);
+        __m128 dynamic = _mm_castsi128_ps(_mm_loadu_si128((__m128i*)(lanes->dynamic_mask + i)));
+
+        // Operand order matches the scalar comparison, including for NaN.
+        __m128 falling = _mm_max_ps(terminal_velocity_v, _mm_add_ps(vy, _mm_mul_ps(gravity_v, weight)));
+        vy = _mm_or_ps(_mm_and_ps(dynamic, falling), _mm_andnot_ps(dynamic, vy));
+
+        vx = _mm_add_ps(vx, _mm_mul_ps(_mm_loadu_ps(lanes->acceleration_x + i), weight));
+        vy = _mm_add_ps(vy, _mm_mul_ps(_mm_loadu_ps(lanes->acceleration_y + i), weight));
+
+        __m128 weighted_scale = _mm_mul_ps(scale_v, weight);
+
+        _mm_storeu_ps(lanes->velocity_x + i, vx);
+        _mm_storeu_ps(lanes->velocity_y + i, vy);
+        _mm_storeu_ps(lanes->step_x + i, _mm_mul_ps(vx, weighted_scale));
+        _mm_storeu_ps(lanes->step_y + i, _mm_mul_ps(vy, weighted_scale));
+    }
+}
+#else
+static void integrate_lanes(Body_Lanes *lanes, u32 count, f32 gravity, f32 terminal_velocity, f32 scale) {
+    for (u32 i = 0; i < count; i++) {
+        f32 weight = lanes->step_weight[i];
+
+        if (lanes->dynamic_mask[i]) {
+            lanes->velocity_y[i] += gravity * weight;
+            if (terminal_velocity > lanes->velocity_y[i]) {
+                lanes->velocity_y[i] = terminal_velocity;
+            }
+        }
+
+        lanes->velocity_x[i] += lanes->acceleration_x[i] * weight;
+        lanes->velocity_y[i] += lanes->acceleration_y[i] * weight;
+        lanes->step_x[i] = lanes->velocity_x[i] * (scale * weight);
+        lanes->step_y[i] = lanes->velocity_y[i] * (scale * weight);
+    }
+}
+#endif
+
+// Enough substeps that no substep moves the body further than its smallest
+// half size, up to max_substeps.
+static u32 body_substep_count(Body *body, f32 step_x, f32 step_y, u32 max_substeps) {
+    f32 distance = fmaxf(fabsf(step_x), fabsf(step_y));
+    f32 half_size = fminf(body->aabb.half_size[0], body->aabb.half_size[1]);
+
+    if (!(distance > half_size)) {
+        return 1;
+    }
+
+    f32 count = ceilf(distance / half_size);
+    return count < max_substeps ? (u32)count : max_substeps;
+}
+
+// Makes room for count bodies, to be filled in with body_lanes_set. The
+// padding at the end is left out of integration.
+void body_lanes_begin(Body_Lanes *lanes, u32 count) {
+    u32 padded_count = (count + LANE_WIDTH - 1) / LANE_WIDTH * LANE_WIDTH;
+
+    lanes_reserve(lanes, padded_count);
+    lanes->count = count;
+
+    for (u32 i = count; i < padded_count; i++) {
+        lanes->velocity_x[i] = 0;
+        lanes->velocity_y[i] = 0;
+        lanes->acceleration_x[i] = 0;
+        lanes->acceleration_y[i] = 0;
+        lanes->step_weight[i] = 0;
+        lanes->dynamic_mask[i] = 0;
+    }
+}
+
+// Applies gravity, terminal velocity and acceleration to every awake body
+// and stores how far each one moves this step and in how many substeps.
+// step_weight in the lanes holds how many steps each body advances by, 0
+// leaves it where it is. The kernel only touches the lanes, the mirrors in
+// Body are synced before it by weigh_bodies and after it here.
+void integrate_bodies(Body_Lanes *lanes, Paged_List *body_list, f32 gravity, f32 terminal_velocity, f32 scale, u32 max_substeps) {
+    u32 count = lanes->count;
+    u32 padded_count = (count + LANE_WIDTH - 1) / LANE_WIDTH * LANE_WIDTH;
+
+    integrate_lanes(lanes, padded_count, gravity, terminal_velocity, scale);
+
+    for (u32 i = 0; i < count; i++) {
+        lanes->substep_count[i] = 1;
+
+        if (lanes->is_integrated[i]) {
+            Body *body = paged_list_get(body_list, i);
+            body->velocity[0] = lanes->velocity_x[i];
+            body->velocity[1] = lanes->velocity_y[i];
+            lanes->substep_count[i] = body_substep_count(body, lanes->step_x[i], lanes->step_y[i], max_substeps);
+        }
+    }
+}
+
+// Bodies with an empty collision mask can't hit anything, so they skip the
+// sweeps entirely and take their full step here.
+void move_maskless_bodies(Body_Lanes *lanes, Paged_List *body_list) {
+    for (u32 i = 0; i < lanes->count; i++) {
+        Body *body = paged_list_get(body_list, i);
+
+        if (!lanes->is_integrated[i] || body->collision_mask != 0) {
+            continue;
+        }
+
+        body->aabb.position[0] += lanes->step_x[i];
+        body->aabb.position[1] += lanes->step_y[i];
+    }
+}
@@ -1,6 +1,6 @@
+#include <string.h>
 #include <linmath.h>
 
-#include "../global.h"
 #include "../array_list.h"
 #include "../util.h"
 #include "../physics.h"
@@ -8,9 +8,20 @@
 
 static Physics_State_Internal state;
 
-static u32 iterations = 2; // Probably better off using more than 2 here. Try using 1 to see why - Engine tutorial guy
-static f32 tick_rate;
+// Bodies are looked up by slot inside the physics, handles are only checked
+// at the public functions.
+static Body *body_get(u32 index) {
+    return paged_list_get(state.body_list, index);
+}
+
+static void body_wake(u32 body_id) {
+    Body *body = body_get(body_id);
+    body->is_sleeping = false;
+    ((u16*)state.still_step_list->items)[body_id] = 0;
+}
 
+// The fixed point build has its own versions of these in fixed.c.
+#ifndef PHYSICS_FIXED_POINT
 void aabb_min_max(vec2 min, vec2 max, AABB aabb) {
     vec2_sub(min, aabb.position, aabb.half_size);
     vec2_add(max, aabb.position, aabb.half_size);
@@ -37,30 +48,40 @@ Hit ray_intersect_aabb(vec2 pos, vec2 magnitude, AABB aabb) {
             f32 t1 = (min[i] - pos[i]) / magnitude[i];
             f32 t2 = (max[i] - pos[i]) / magnitude[i];
 
-            last_entry = fmaxf(last_entry, fminf(t1, t2));
-            first_exit = fminf(first_exit, fmaxf(t1, t2));
+            last_entry = ray_max(last_entry, ray_min(t1, t2));
+            first_exit = ray_min(first_exit, ray_max(t1, t2));
         } else if (pos[i] <= min[i] || pos[i] >= max[i]) {
             return hit;
         }
     }
 
     if (first_exit > last_entry && first_exit > 0 && last_entry < 1) {
-        hit.position[0] = pos[0] + magnitude[0] * last_entry;
-        hit.position[1] = pos[1] + magnitude[1] * last_entry;
+        hit = ray_hit_at(pos, magnitude, aabb, last_entry);
+    }
 
-        hit.is_hit = true;
-        hit.time = last_entry;
+    return hit;
+}
 
-        f32 dx = hit.position[0] - aabb.position[0];
-        f32 dy = hit.position[1] - aabb.position[1];
-        f32 px = aabb.half_size[0] - fabsf(dx);
-        f32 py = aabb.half_size[1] - fabsf(dy);
+// Fills in the hit of a ray entering aabb at time. Shared with the batched
+// sweep so both agree on position and normal.
+Hit ray_hit_at(vec2 pos, vec2 magnitude, AABB aabb, f32 time) {
+    Hit hit = {0};
 
-        if (px < py) {
-            hit.normal[0] = (dx > 0) - (dx < 0);
-        } else {
-            hit.normal[1] = (dy > 0) - (dy < 0);
-        }
+    hit.position[0] = pos[0] + magnitude[0] * time;
+    hit.position[1] = pos[1] + magnitude[1] * time;
+
+    hit.is_hit = true;
+    hit.time = time;
+
+    f32 dx = hit.position[0] - aabb.position[0];
+    f32 dy = hit.position[1] - aabb.position[1];
+    f32 px = aabb.half_size[0] - fabsf(dx);
+    f32 py = aabb.half_size[1] - fabsf(dy);
+
+    if (px < py) {
+        hit.normal[0] = (dx > 0) - (dx < 0);
+    } else {
+        hit.normal[1] = (dy > 0) - (dy < 0);
     }
 
     return hit;
@@ -106,111 +127,355 @@ bool physics_point_intersect_aabb(vec2 point, AABB aabb) {
            point[1] >= min[1] &&
            point[1] <= max[1];
 }
+#endif
+
+static void swept_min_max(vec2 min, vec2 max, AABB aabb, vec2 displacement) {
+    aabb_min_max(min, max, aabb);
+
+    for (u8 i = 0; i < 2; i++) {
+        if (displacement[i] < 0) {
+            min[i] += displacement[i];
+        } else {
+            max[i] += displacement[i];
+        }
+    }
+}
+
+static void scratch_init(Physics_Scratch *scratch) {
+    *scratch = (Physics_Scratch){
+        .query = {.stamp_list = array_list_create(sizeof(u32), 0)},
+        .candidate_list = array_list_create(sizeof(u32), 0),
+        .static_candidate_list = array_list_create(sizeof(u32), 0),
+        .contact_list = array_list_create(sizeof(Contact), 0),
+        .overlap_list = array_list_create(sizeof(Handle), 0),
+        .step_statics = {.id_list = array_list_create(sizeof(u32), 0)},
+        .step_bodies = {.id_list = array_list_create(sizeof(u32), 0)},
+    };
+}
+
+static Physics_Scratch *scratch_get(u32 thread_index) {
+    return (Physics_Scratch*)state.scratch_list->items + thread_index;
+}
+
+// Empty grid, so queries fall back to checking every body until the next
+// step builds a real one.
+static void clear_broadphase(void) {
+    broadphase_grid_begin(&state.grid, 0);
+    broadphase_grid_end(&state.grid);
+}
 
 void physics_init(void) {
-    state.body_list = array_list_create(sizeof(Body), 0);
+    state.body_map = slot_map_create(sizeof(Body), 0);
+    state.body_list = state.body_map->item_list;
+    state.body_callback_id_list = array_list_create(sizeof(u32), 0);
+    state.callback_table = array_list_create(sizeof(Body_Callbacks), 0);
     state.static_body_list = array_list_create(sizeof(Static_Body), 0);
+    state.scratch_list = array_list_create(sizeof(Physics_Scratch), 1);
+    state.substep_list = array_list_create(sizeof(Substep_Record), 0);
+    state.stepped_list = array_list_create(sizeof(u8), 0);
+    state.event_handle_list = array_list_create(sizeof(Handle), 0);
+    state.previous_position_list = array_list_create(sizeof(vec2), 0);
+    state.still_step_list = array_list_create(sizeof(u16), 0);
+    state.lod_skip_list = array_list_create(sizeof(u16), 0);
+    state.step_weight_list = array_list_create(sizeof(u16), 0);
+    state.snapshot_scratch = array_list_create(1, 0);
+    broadphase_grid_init(&state.grid, BROADPHASE_CELL_SIZE);
+    clear_broadphase();
+    sap_init(&state.sap);
+    for (u32 i = 0; i < STATIC_TREE_COUNT; i++) {
+        bvh_init(&state.static_trees[i], i);
+    }
+    contact_cache_init(&state.contact_cache);
+    trigger_store_init(&state.triggers);
+
+    physics_list_resize(state.scratch_list, 1);
+    scratch_init(scratch_get(0));
+    physics_workers_start(&state.workers, 1);
 
     state.gravity = -79;
     state.terminal_velocity = -7000;
 
-    tick_rate = 1.f / iterations;
+    state.max_substeps = PHYSICS_DEFAULT_MAX_SUBSTEPS;
+    state.lod_interval = 1;
+
+    physics_step_rate_set(PHYSICS_DEFAULT_STEP_RATE, PHYSICS_DEFAULT_MAX_STEPS);
+}
+
+// Steps are always 1 / step_rate seconds long. A frame runs at most
+// max_steps of them, the rest of a long frame is dropped instead of
+// being caught up on.
+void physics_step_rate_set(u32 step_rate, u32 max_steps) {
+    state.step_delta = 1.f / step_rate;
+    state.max_steps = max_steps;
+    state.accumulator = 0;
 }
 
-static void update_sweep_result(Hit *result, Body *body, size_t other_id, vec2 velocity) {
-    Body *other = physics_body_get(other_id);
+// Bodies take as many substeps as keep each one shorter than their smallest
+// half size, but never more than max_substeps.
+void physics_max_substeps_set(u32 max_substeps) {
+    state.max_substeps = max_substeps > 0 ? max_substeps : 1;
+}
 
-    if ((body->collision_mask & other->collision_layer) == 0) {
-        return;
+// Finds the bodies each moving body may run into with an incremental sweep
+// and prune instead of the grid. Pays off when bodies move little from one
+// step to the next.
+void physics_sweep_and_prune_set(bool is_enabled) {
+    state.is_sap_enabled = is_enabled;
+    sap_clear(&state.sap);
+}
+
+// Keeps the static bodies and triggers, which only change with the level,
+// in arena. physics_reset releases the arena and allocates them again, so
+// nothing else may keep memory in it.
+void physics_level_arena_set(Arena *arena) {
+    state.level_arena = arena;
+}
+
+// Scratch memory that is only needed during a call comes from arena, which
+// the caller resets every frame.
+void physics_frame_arena_set(Arena *arena) {
+    state.frame_arena = arena;
+}
+
+// Bodies outside region are only stepped every interval steps, and then
+// advance by all the steps they skipped at once. Sweeps cover the whole
+// distance, so they still stop at static bodies. An interval of 1 steps
+// every body every step.
+void physics_lod_set(AABB region, u32 interval) {
+    state.lod_region = region;
+    state.lod_interval = interval > 0 ? interval : 1;
+}
+
+// Substeps the bodies took in the last physics_update, or since the last
+// physics_update or physics_reset when stepping with physics_step.
+u32 physics_substep_count(void) {
+    return state.substep_total;
+}
+
+// Splits physics_update across thread_count threads. 1 keeps everything on
+// the calling thread.
+void physics_thread_count_set(u32 thread_count) {
+    if (thread_count == 0) {
+        thread_count = 1;
     }
 
-    AABB sum_aabb = other->aabb;
-    vec2_add(sum_aabb.half_size, sum_aabb.half_size, body->aabb.half_size);
+    physics_workers_stop(&state.workers);
 
-    Hit hit = ray_intersect_aabb(body->aabb.position, velocity, sum_aabb);
-    if (hit.is_hit) {
-        if (body->on_hit && (body->collision_mask & other->collision_layer) == 0) {
-            body->on_hit(body, other, hit);
+    size_t len = state.scratch_list->len;
+    if (len < thread_count) {
+        physics_list_resize(state.scratch_list, thread_count);
+        for (size_t i = len; i < thread_count; i++) {
+            scratch_init(scratch_get(i));
         }
+    }
+
+    physics_workers_start(&state.workers, thread_count);
+}
+
+static void update_sweep_result(Hit *result, Hit hit, size_t other_id, vec2 velocity) {
+    hit.other_id = other_id;
 
-        if (hit.time < result->time) {
+    if (hit.time < result->time) {
+        *result = hit;
+    } else if (hit.time == result->time) {
+        // Solve highest velocity axis first.
+        if (fabsf(velocity[0]) > fabsf(velocity[1]) && hit.normal[0] != 0) {
+            *result = hit;
+        } else if (fabsf(velocity[1]) > fabsf(velocity[0]) && hit.normal[1] != 0) {
             *result = hit;
-        } else if (hit.time == result->time) {
-            // Solve highest velocity axis first.
-            if (fabsf(velocity[0]) > fabsf(velocity[1]) && hit.normal[0] != 0) {
-                *result = hit;
-            } else if (fabsf(velocity[1]) > fabsf(velocity[0]) && hit.normal[1] != 0) {
-                *result = hit;
-            }
         }
-        result->other_id = other_id;
     }
 }
 
-static void update_sweep_result_static(Hit *result, Body *body, size_t other_id, vec2 velocity) {
-    Static_Body *static_body = physics_static_body_get(other_id);
+// Runs the packed candidates through the batched ray test and folds the hits
+// into a result in candidate order.
+static Hit sweep_boxes_result(Sweep_Boxes *boxes, vec2 position, vec2 velocity) {
+    Hit result = {.time = 0xBEEF};
 
-    if ((body->collision_mask & static_body->collision_layer) == 0) {
-        return;
+    u32 hit_count = ray_intersect_boxes(boxes, position, velocity);
+    for (u32 i = 0; i < hit_count; i++) {
+        u32 index = boxes->hit_index[i];
+        Hit hit = ray_hit_at(position, velocity, boxes->aabb[index], boxes->entry_time[index]);
+        update_sweep_result(&result, hit, boxes->id[index], velocity);
     }
 
-    AABB sum_aabb = static_body->aabb;
-    vec2_add(sum_aabb.half_size, sum_aabb.half_size, body->aabb.half_size);
+    return result;
+}
+
+static void static_trees_mark_dirty(void) {
+    for (u32 i = 0; i < STATIC_TREE_COUNT; i++) {
+        state.static_trees[i].is_dirty = true;
+    }
+}
 
-    Hit hit = ray_intersect_aabb(body->aabb.position, velocity, sum_aabb);
-    if (hit.is_hit) {
-        if (hit.time < result->time) {
-            *result = hit;
-        } else if (hit.time == result->time) {
-            // Solve highest velocity axis first.
-            if (fabsf(velocity[0]) > fabsf(velocity[1]) && hit.normal[0] != 0) {
-                *result = hit;
-            } else if (fabsf(velocity[1]) > fabsf(velocity[0]) && hit.normal[1] != 0) {
-                *result = hit;
-            }
+static void static_trees_build(void) {
+    for (u32 i = 0; i < STATIC_TREE_COUNT; i++) {
+        if (state.static_trees[i].is_dirty) {
+            bvh_build(&state.static_trees[i], state.static_body_list);
         }
-        result->other_id = other_id;
     }
 }
 
-static Hit sweep_static_bodies(Body *body, vec2 velocity) {
-    Hit result = {.time = 0xBEEF};
+// Gathers the static bodies touching min/max from the trees selected by
+// tree_mask, one bit per layer bit plus STATIC_TREE_LAYERLESS, in ascending
+// id order.
+static void query_static_bodies(Physics_Scratch *scratch, vec2 min, vec2 max, u32 tree_mask) {
+    scratch->static_candidate_list->len = 0;
+    u32 tree_count = 0;
 
-    for (u32 i = 0; i < state.static_body_list->len; i++) {
-        Static_Body *static_body = physics_static_body_get(i);
+    for (u32 i = 0; i < STATIC_TREE_COUNT; i++) {
+        if ((tree_mask & (1 << i)) == 0) {
+            continue;
+        }
+
+        if (state.static_trees[i].is_dirty) {
+            bvh_build(&state.static_trees[i], state.static_body_list);
+        }
 
-        update_sweep_result_static(&result, body, i, velocity);
+        if (state.static_trees[i].item_list->len > 0) {
+            bvh_query(&state.static_trees[i], min, max, scratch->static_candidate_list);
+            tree_count++;
+        }
     }
 
-    return result;
+    physics_sort_ids(scratch->static_candidate_list);
+
+    // Statics with several layer bits are in several trees.
+    if (tree_count > 1) {
+        physics_unique_ids(scratch->static_candidate_list);
+    }
 }
 
-static Hit sweep_bodies(Body *body, vec2 velocity) {
-    Hit result = {.time = 0xBEEF};
+static bool step_candidates_cover(Step_Candidates *step, vec2 min, vec2 max) {
+    return step->is_gathered &&
+           min[0] >= step->min[0] && min[1] >= step->min[1] &&
+           max[0] <= step->max[0] && max[1] <= step->max[1];
+}
+
+static void grow_region(vec2 min, vec2 max, f32 x, f32 y) {
+    vec2_sub(min, min, (vec2){x, y});
+    vec2_add(max, max, (vec2){x, y});
+}
+
+// Gathers the static bodies near body once for all of its substeps, from
+// the region min/max it covers during the step.
+static void step_statics_gather(Physics_Scratch *scratch, Body *body, vec2 min, vec2 max) {
+    Step_Candidates *statics = &scratch->step_statics;
+    vec2_dup(statics->min, min);
+    vec2_dup(statics->max, max);
+
+    // Leave room for the penetration region and rounding in the substeps.
+    grow_region(statics->min, statics->max, body->aabb.half_size[0] * 2 + BROADPHASE_MARGIN * 2, body->aabb.half_size[1] * 2 + BROADPHASE_MARGIN * 2);
+    query_static_bodies(scratch, statics->min, statics->max, STATIC_TREE_ALL);
+
+    Array_List *id_list = statics->id_list;
+    statics->id_list = scratch->static_candidate_list;
+    scratch->static_candidate_list = id_list;
+    statics->is_gathered = true;
+}
+
+// Same for the other bodies, which only bodies with an on_hit callback look
+// for.
+static void step_bodies_gather(Physics_Scratch *scratch, Body *body, vec2 min, vec2 max) {
+    Step_Candidates *bodies = &scratch->step_bodies;
+    vec2_dup(bodies->min, min);
+    vec2_dup(bodies->max, max);
+    grow_region(bodies->min, bodies->max, BROADPHASE_MARGIN, BROADPHASE_MARGIN);
+    broadphase_grid_query(&state.grid, &scratch->query, body->collision_mask, bodies->min, bodies->max, state.body_list->len, bodies->id_list);
+    bodies->is_gathered = true;
+}
 
-    for (u32 i = 0; i < state.body_list->len; i++) {
-        Body *other = physics_body_get(i);
+static void step_candidates_end(Physics_Scratch *scratch) {
+    scratch->step_statics.is_gathered = false;
+    scratch->step_bodies.is_gathered = false;
+}
+
+// Static bodies that may touch min/max, straight from the list gathered for
+// the step while the region stays inside it.
+static Array_List *static_candidates(Physics_Scratch *scratch, vec2 min, vec2 max, u32 tree_mask) {
+    if (step_candidates_cover(&scratch->step_statics, min, max)) {
+        return scratch->step_statics.id_list;
+    }
+
+    query_static_bodies(scratch, min, max, tree_mask);
+    return scratch->static_candidate_list;
+}
+
+static Array_List *body_candidates(Physics_Scratch *scratch, Body *body, vec2 min, vec2 max) {
+    if (step_candidates_cover(&scratch->step_bodies, min, max)) {
+        return scratch->step_bodies.id_list;
+    }
+
+    broadphase_grid_query(&state.grid, &scratch->query, body->collision_mask, min, max, state.body_list->len, scratch->candidate_list);
+    return scratch->candidate_list;
+}
+
+static Hit sweep_static_bodies(Physics_Scratch *scratch, Body *body, vec2 velocity) {
+    vec2 min, max;
+    swept_min_max(min, max, body->aabb, velocity);
+    vec2_sub(min, min, (vec2){BROADPHASE_MARGIN, BROADPHASE_MARGIN});
+    vec2_add(max, max, (vec2){BROADPHASE_MARGIN, BROADPHASE_MARGIN});
+    Array_List *candidate_list = static_candidates(scratch, min, max, body->collision_mask);
+
+    sweep_boxes_clear(&scratch->sweep_boxes);
 
-        if (body == other) {
+    u32 *candidates = candidate_list->items;
+    for (size_t i = 0; i < candidate_list->len; i++) {
+        Static_Body *static_body = physics_static_body_get(candidates[i]);
+
+        if ((body->collision_mask & static_body->collision_layer) == 0) {
             continue;
         }
 
-        update_sweep_result(&result, body, i, velocity);
+        sweep_boxes_push(&scratch->sweep_boxes, candidates[i], static_body->aabb, body->aabb.half_size);
     }
 
-    return result;
+    return sweep_boxes_result(&scratch->sweep_boxes, body->aabb.position, velocity);
+}
+
+// Where other_id is while body_id is being stepped in a parallel update.
+// Bodies before body_id have already moved, bodies after it have not.
+static AABB contact_aabb(u32 other_id, u32 body_id, vec2 position) {
+    Body *other = body_get(other_id);
+    AABB aabb = other->aabb;
+    u8 *stepped = state.stepped_list->items;
+
+    if (other_id == body_id) {
+        aabb.position[0] = position[0];
+        aabb.position[1] = position[1];
+    } else if (other_id > body_id && other_id < state.stepped_list->len && stepped[other_id]) {
+        Substep_Record *substep = (Substep_Record*)state.substep_list->items + other_id * state.max_substeps;
+        aabb.position[0] = substep->sweep_position[0];
+        aabb.position[1] = substep->sweep_position[1];
+    }
+
+    return aabb;
+}
+
+static Body_Callbacks *body_callbacks_get(size_t body_id) {
+    u32 *callback_id = u32_list_get(state.body_callback_id_list, body_id);
+    return (Body_Callbacks*)state.callback_table->items + *callback_id;
 }
 
-static void sweep_response(Body *body, vec2 velocity) {
-    Hit hit = sweep_static_bodies(body, velocity);
-    Hit hit_moving = sweep_bodies(body, velocity);
+// Bodies share one entry per distinct pair of callbacks.
+static u32 body_callbacks_id(On_Hit on_hit, On_Hit_Static on_hit_static) {
+    Body_Callbacks *callbacks = state.callback_table->items;
 
-    if (hit_moving.is_hit) {
-        if (body->on_hit != NULL) {
-            body->on_hit(body, physics_body_get(hit_moving.other_id), hit_moving);
+    for (u32 i = 0; i < state.callback_table->len; i++) {
+        if (callbacks[i].on_hit == on_hit && callbacks[i].on_hit_static == on_hit_static) {
+            return i;
         }
     }
 
+    Body_Callbacks entry = {.on_hit = on_hit, .on_hit_static = on_hit_static};
+    if (array_list_append(state.callback_table, &entry) == (size_t)-1) {
+        ERROR_EXIT("Could not append body callbacks to table\n");
+    }
+
+    return (u32)state.callback_table->len - 1;
+}
+
+static void static_response(Body *body, Hit hit, vec2 velocity) {
     if (hit.is_hit) {
         body->aabb.position[0] = hit.position[0];
         body->aabb.position[1] = hit.position[1];
@@ -222,17 +487,49 @@ static void sweep_response(Body *body, vec2 velocity) {
             body->aabb.position[0] += velocity[0];
             body->velocity[1] = 0;
         }
-
-        if (body->on_hit_static != NULL) {
-            body->on_hit_static(body, physics_static_body_get(hit.other_id), hit);
-        }
     } else {
         vec2_add(body->aabb.position, body->aabb.position, velocity);
     }
 }
 
-static void stationary_response(Body *body) {
-    for (u32 i = 0; i < state.static_body_list->len; i++) {
+static void contact_append(Physics_Scratch *scratch, u32 body_id, Contact_Kind kind, Hit hit) {
+    contact_list_append(scratch->contact_list, (Contact){.body_id = body_id, .other_id = (u32)hit.other_id, .kind = kind, .hit = hit});
+}
+
+// Contacts are only recorded for bodies with a callback to report them to.
+static void sweep_response(Physics_Scratch *scratch, Body *body, size_t body_id, vec2 velocity) {
+    Hit hit = sweep_static_bodies(scratch, body, velocity);
+    Body_Callbacks *callbacks = body_callbacks_get(body_id);
+
+    static_response(body, hit, velocity);
+
+    if (hit.is_hit && callbacks->on_hit_static != NULL) {
+        contact_append(scratch, body_id, CONTACT_KIND_STATIC, hit);
+    }
+}
+
+// Region the penetration candidates are gathered from. Grown by the size of
+// the body, since being pushed out of one static body can move it into
+// another one.
+static void penetration_region(vec2 min, vec2 max, AABB aabb) {
+    aabb_min_max(min, max, aabb);
+
+    for (u8 i = 0; i < 2; i++) {
+        min[i] -= aabb.half_size[i] * 2 + BROADPHASE_MARGIN;
+        max[i] += aabb.half_size[i] * 2 + BROADPHASE_MARGIN;
+    }
+}
+
+static void penetration_response(Physics_Scratch *scratch, Body *body) {
+    vec2 region_min, region_max;
+    penetration_region(region_min, region_max, body->aabb);
+    Array_List *candidate_list = static_candidates(scratch, region_min, region_max, STATIC_TREE_ALL);
+
+    u32 *candidates = candidate_list->items;
+    size_t next = 0;
+
+    while (next < candidate_list->len) {
+        u32 i = candidates[next++];
         Static_Body *static_body = physics_static_body_get(i);
 
         AABB aabb = aabb_minkowski_difference(static_body->aabb, body->aabb);
@@ -244,130 +541,1251 @@ static void stationary_response(Body *body) {
             aabb_penetration_vector(penetration_vector, aabb);
 
             vec2_add(body->aabb.position, body->aabb.position, penetration_vector);
+
+            // Pushed out of the region, gather the remaining candidates again.
+            vec2 body_min, body_max;
+            aabb_min_max(body_min, body_max, body->aabb);
+
+            if (body_min[0] < region_min[0] || body_min[1] < region_min[1] || body_max[0] > region_max[0] || body_max[1] > region_max[1]) {
+                penetration_region(region_min, region_max, body->aabb);
+                candidate_list = static_candidates(scratch, region_min, region_max, STATIC_TREE_ALL);
+
+                candidates = candidate_list->items;
+                for (next = 0; next < candidate_list->len && candidates[next] <= i; next++);
+            }
         }
     }
+}
 
-    // Check for on-hit events.
-    for (size_t i = 0; i < state.body_list->len; i++) {
-        Body *other = physics_body_get(i);
+// Gathers the bodies overlapping body at position into the candidate list.
+// Includes body itself when its mask selects its own layer.
+static void overlap_bodies(Physics_Scratch *scratch, Body *body, size_t body_id, vec2 position, bool is_parallel) {
+    AABB aabb = {
+        .position = { position[0], position[1] },
+        .half_size = { body->aabb.half_size[0], body->aabb.half_size[1] },
+    };
 
-        if (!body->on_hit) {
-            continue;
-        }
+    vec2 body_min, body_max;
+    aabb_min_max(body_min, body_max, aabb);
+    Array_List *candidate_list = body_candidates(scratch, body, body_min, body_max);
+
+    // Compacted in place when the candidates were just queried.
+    size_t candidate_count = candidate_list->len;
+    physics_list_resize(scratch->candidate_list, candidate_count);
+    u32 *candidates = candidate_list->items;
+    u32 *overlaps = scratch->candidate_list->items;
+    size_t overlap_count = 0;
+
+    for (size_t j = 0; j < candidate_count; j++) {
+        u32 i = candidates[j];
+        Body *other = body_get(i);
 
         if ((body->collision_mask & other->collision_layer) == 0) {
             continue;
         }
 
-        AABB aabb = aabb_minkowski_difference(other->aabb, body->aabb);
+        AABB other_aabb = is_parallel ? contact_aabb(i, body_id, position) : other->aabb;
+        AABB difference = aabb_minkowski_difference(other_aabb, aabb);
         vec2 min, max;
-        aabb_min_max(min, max, aabb);
+        aabb_min_max(min, max, difference);
 
         if (min[0] <= 0 && max[0] >= 0 && min[1] <= 0 && max[1] >= 0) {
-            body->on_hit(body, other, (Hit){.is_hit = true, .other_id = i});
+            overlaps[overlap_count++] = i;
         }
     }
+
+    scratch->candidate_list->len = overlap_count;
 }
 
-void physics_update(void) {
-    Body *body;
+static void stationary_response(Physics_Scratch *scratch, Body *body, size_t body_id) {
+    penetration_response(scratch, body);
 
-    for (u32 i = 0; i < state.body_list->len; ++i) {
-        body = array_list_get(state.body_list, i);
+    if (body_callbacks_get(body_id)->on_hit == NULL) {
+        return;
+    }
 
-        if (!body->is_active) {
+    // Check for on-hit events.
+    overlap_bodies(scratch, body, body_id, body->aabb.position, false);
+
+    u32 *candidates = scratch->candidate_list->items;
+    for (size_t j = 0; j < scratch->candidate_list->len; j++) {
+        contact_append(scratch, body_id, CONTACT_KIND_BODY, (Hit){.is_hit = true, .other_id = candidates[j]});
+    }
+}
+
+// How far body_id moves this step when nothing stops it.
+static void step_displacement(vec2 result, u32 body_id) {
+    if (body_id < state.lanes.count && state.lanes.is_integrated[body_id]) {
+        result[0] = state.lanes.step_x[body_id];
+        result[1] = state.lanes.step_y[body_id];
+    } else {
+        result[0] = 0;
+        result[1] = 0;
+    }
+}
+
+// Inserts every body that can be hit into the grid, covering the whole
+// distance it is going to travel this frame. Runs after integration.
+static void build_broadphase(void) {
+    u32 body_count = state.body_list->len;
+    broadphase_grid_begin(&state.grid, body_count);
+    if (state.is_sap_enabled) {
+        sap_begin(&state.sap, body_count);
+    }
+
+    for (u32 i = 0; i < body_count; i++) {
+        Body *body = body_get(i);
+
+        if (!body->is_active || (body->collision_layer == 0 && body->collision_mask == 0)) {
             continue;
         }
 
-        if (!body->is_kinematic) {
-            body->velocity[1] += state.gravity;
-            if (state.terminal_velocity > body->velocity[1]) {
-                body->velocity[1] = state.terminal_velocity;
-            }
-        }
+        vec2 displacement, min, max;
+        step_displacement(displacement, i);
+        swept_min_max(min, max, body->aabb, displacement);
 
-        body->velocity[0] += body->acceleration[0];
-        body->velocity[1] += body->acceleration[1];
+        // Leave room for rounding in the substeps.
+        vec2_sub(min, min, (vec2){BROADPHASE_MARGIN, BROADPHASE_MARGIN});
+        vec2_add(max, max, (vec2){BROADPHASE_MARGIN, BROADPHASE_MARGIN});
 
-        vec2 scaled_velocity;
-        vec2_scale(scaled_velocity, body->velocity, global.time.delta * tick_rate);
+        // Sweep and prune pairs are found from both sides, so layerless
+        // bodies go in to find the others. The grid is only searched by
+        // mask, and layerless bodies can never be selected by one.
+        if (state.is_sap_enabled) {
+            sap_set(&state.sap, i, min, max);
+        }
 
-        for (u32 j = 0; j < iterations; j++) {
-            sweep_response(body, scaled_velocity);
-            stationary_response(body);
+        if (body->collision_layer != 0) {
+            broadphase_grid_insert(&state.grid, i, body->collision_layer, min, max);
         }
     }
+
+    broadphase_grid_end(&state.grid);
+    if (state.is_sap_enabled) {
+        sap_end(&state.sap);
+    }
 }
 
-size_t physics_body_create(vec2 position, vec2 size, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static, size_t entity_id) {
-    size_t id = state.body_list->len;
+// Awake bodies that can hit something. The others were already moved by
+// move_maskless_bodies.
+static bool body_is_stepped(u32 body_id) {
+    return body_id < state.lanes.count && state.lanes.is_integrated[body_id] && body_get(body_id)->collision_mask != 0;
+}
 
-    // Find inactive Body.
-    for (size_t i = 0; i < state.body_list->len; i++) {
-        Body *body = array_list_get(state.body_list, i);
-        if (!body->is_active) {
-            id = i;
-            break;
-        }
+static void job_range(u32 *first, u32 *last, u64 count, u32 thread_index, u32 thread_count) {
+    *first = (u32)(count * thread_index / thread_count);
+    *last = (u32)(count * (thread_index + 1) / thread_count);
+}
+
+// Bodies whose swept bounds overlap those of body_id, in ascending order.
+static u32 *sweep_candidates(Physics_Scratch *scratch, Body *body, u32 body_id, AABB aabb, vec2 displacement, u32 *count) {
+    if (state.is_sap_enabled) {
+        return sap_neighbors(&state.sap, body_id, count);
     }
 
-    if (id == state.body_list->len) {
-        if (array_list_append(state.body_list, &(Body){0}) == (size_t)-1) {
-            ERROR_EXIT("Could not append body to list\n");
+    vec2 min, max;
+    swept_min_max(min, max, aabb, displacement);
+    grow_region(min, max, BROADPHASE_MARGIN, BROADPHASE_MARGIN);
+    broadphase_grid_query(&state.grid, &scratch->query, body->collision_mask, min, max, state.body_list->len, scratch->candidate_list);
+
+    *count = (u32)scratch->candidate_list->len;
+    return scratch->candidate_list->items;
+}
+
+// Sweeps body against the other bodies over the whole step. Both may be
+// moving, so each pair is swept with their relative displacement from where
+// they started the step, which finds the time of impact in one go however
+// fast they close in on each other. The hit position is where body is at
+// that time.
+static Hit sweep_bodies(Physics_Scratch *scratch, Body *body, u32 body_id) {
+    vec2 *start_positions = state.previous_position_list->items;
+    AABB aabb = {
+        .position = { start_positions[body_id][0], start_positions[body_id][1] },
+        .half_size = { body->aabb.half_size[0], body->aabb.half_size[1] },
+    };
+
+    vec2 displacement;
+    step_displacement(displacement, body_id);
+    u32 candidate_count;
+    u32 *candidates = sweep_candidates(scratch, body, body_id, aabb, displacement, &candidate_count);
+
+    Hit result = {.time = 0xBEEF};
+
+    for (size_t i = 0; i < candidate_count; i++) {
+        u32 other_id = candidates[i];
+        Body *other = body_get(other_id);
+
+        if (other_id == body_id || !other->is_active || (body->collision_mask & other->collision_layer) == 0) {
+            continue;
+        }
+
+        vec2 other_displacement, relative;
+        step_displacement(other_displacement, other_id);
+        vec2_sub(relative, displacement, other_displacement);
+
+        // Moving together, only the overlap tests can find them.
+        if (relative[0] == 0 && relative[1] == 0) {
+            continue;
+        }
+
+        AABB sum_aabb = {
+            .position = { start_positions[other_id][0], start_positions[other_id][1] },
+            .half_size = { other->aabb.half_size[0] + aabb.half_size[0], other->aabb.half_size[1] + aabb.half_size[1] },
+        };
+
+        Hit hit = ray_intersect_aabb(aabb.position, relative, sum_aabb);
+        if (!hit.is_hit) {
+            continue;
         }
+
+        Hit moved = ray_hit_at(aabb.position, displacement, sum_aabb, hit.time);
+        vec2_dup(hit.position, moved.position);
+        update_sweep_result(&result, hit, other_id, relative);
     }
 
-    Body *body = physics_body_get(id);
+    return result;
+}
 
-    *body = (Body){
-        .aabb = {
-            .position = { position[0], position[1] },
-            .half_size = { size[0] * 0.5, size[1] * 0.5 },
-        },
-        .velocity = { velocity[0], velocity[1] },
-        .collision_layer = collision_layer,
-        .collision_mask = collision_mask,
-        .on_hit = on_hit,
-        .on_hit_static = on_hit_static,
-        .is_kinematic = is_kinematic,
-        .is_active = true,
-        .entity_id = entity_id
-    };
+// Body sweeps only depend on where bodies started the step, so they run as
+// one pass before any body moves and give the same contacts on any number of
+// threads.
+static void sweep_bodies_job(u32 thread_index, u32 thread_count, void *data) {
+    Physics_Scratch *scratch = scratch_get(thread_index);
+    u32 first, last;
+    job_range(&first, &last, state.lanes.count, thread_index, thread_count);
 
-    return id;
+    for (u32 i = first; i < last; i++) {
+        if (!body_is_stepped(i) || body_callbacks_get(i)->on_hit == NULL) {
+            continue;
+        }
+
+        Hit hit = sweep_bodies(scratch, body_get(i), i);
+        if (hit.is_hit) {
+            contact_append(scratch, i, CONTACT_KIND_BODY, hit);
+        }
+    }
 }
-Body *physics_body_get(size_t index) {
-    return array_list_get(state.body_list, index);
+
+// How far body_id moves in each of its substeps.
+static void substep_velocity(vec2 result, u32 body_id) {
+    u32 count = state.lanes.substep_count[body_id];
+    result[0] = state.lanes.step_x[body_id] / count;
+    result[1] = state.lanes.step_y[body_id] / count;
 }
 
-size_t physics_trigger_create(vec2 position, vec2 size, u8 collision_layer, u8 collision_mask, On_Hit on_hit) {
-    return physics_body_create(position, size, (vec2){0, 0}, collision_layer, collision_mask, true, on_hit, NULL, (size_t)-1);
+// Gathers the candidates of body from the AABB swept over all substeps.
+static void step_candidates_gather_swept(Physics_Scratch *scratch, Body *body, u32 body_id, bool has_on_hit) {
+    vec2 displacement, min, max;
+    step_displacement(displacement, body_id);
+    swept_min_max(min, max, body->aabb, displacement);
+    step_statics_gather(scratch, body, min, max);
+
+    if (has_on_hit) {
+        step_bodies_gather(scratch, body, min, max);
+    }
 }
 
-size_t physics_static_body_create(vec2 position, vec2 size, u8 collision_layer) {
-    Static_Body static_body = {
-        .aabb = {
-            .position = { position[0], position[1] },
-            .half_size = { size[0] * 0.5, size[1] * 0.5 },
-        },
-        .collision_layer = collision_layer,
-    };
+static void step_body(Physics_Scratch *scratch, u32 body_id) {
+    Body *body = body_get(body_id);
+    vec2 scaled_velocity;
+    substep_velocity(scaled_velocity, body_id);
 
-    if (array_list_append(state.static_body_list, &static_body) == (size_t)-1)
-        ERROR_EXIT("Could not append static body to list\n");
+    step_candidates_gather_swept(scratch, body, body_id, body_callbacks_get(body_id)->on_hit != NULL);
 
-    return state.static_body_list->len - 1;
+    for (u32 j = 0; j < state.lanes.substep_count[body_id]; j++) {
+        sweep_response(scratch, body, body_id, scaled_velocity);
+        stationary_response(scratch, body, body_id);
+    }
+
+    step_candidates_end(scratch);
+
+    vec2 min, max;
+    aabb_min_max(min, max, body->aabb);
+    broadphase_grid_update(&state.grid, body_id, min, max);
+
+    // Every query visits the escaped bodies, rebuild once there are many.
+    if (state.grid.overflow_list->len > BROADPHASE_MAX_OVERFLOW) {
+        build_broadphase();
+    }
 }
 
-Static_Body *physics_static_body_get(size_t index) {
-    return array_list_get(state.static_body_list, index);
+// First parallel pass. Moves every body against the static bodies, which
+// only depends on the body itself, and records where it was each substep.
+static void move_job(u32 thread_index, u32 thread_count, void *data) {
+    Physics_Scratch *scratch = scratch_get(thread_index);
+    u8 *stepped = state.stepped_list->items;
+    u32 first, last;
+    job_range(&first, &last, state.stepped_list->len, thread_index, thread_count);
+
+    for (u32 i = first; i < last; i++) {
+        Body *body = body_get(i);
+        stepped[i] = body_is_stepped(i);
+
+        if (!stepped[i]) {
+            continue;
+        }
+
+        vec2 scaled_velocity;
+        substep_velocity(scaled_velocity, i);
+        Substep_Record *substeps = (Substep_Record*)state.substep_list->items + i * state.max_substeps;
+
+        step_candidates_gather_swept(scratch, body, i, false);
+
+        for (u32 j = 0; j < state.lanes.substep_count[i]; j++) {
+            vec2_dup(substeps[j].sweep_position, body->aabb.position);
+            substeps[j].static_hit = sweep_static_bodies(scratch, body, scaled_velocity);
+            static_response(body, substeps[j].static_hit, scaled_velocity);
+            penetration_response(scratch, body);
+            vec2_dup(substeps[j].stationary_position, body->aabb.position);
+        }
+
+        step_candidates_end(scratch);
+    }
 }
 
-size_t physics_static_body_count() {
-    return state.static_body_list->len;
+// Region the recorded substeps of body cover, swept and stationary.
+static void substep_region(vec2 min, vec2 max, Body *body, Substep_Record *substeps, u32 substep_count, vec2 scaled_velocity) {
+    for (u32 j = 0; j < substep_count; j++) {
+        AABB aabb = {.half_size = {body->aabb.half_size[0], body->aabb.half_size[1]}};
+        vec2 sweep_min, sweep_max, stationary_min, stationary_max;
+
+        vec2_dup(aabb.position, substeps[j].sweep_position);
+        swept_min_max(sweep_min, sweep_max, aabb, scaled_velocity);
+        vec2_dup(aabb.position, substeps[j].stationary_position);
+        aabb_min_max(stationary_min, stationary_max, aabb);
+
+        for (u8 axis = 0; axis < 2; axis++) {
+            f32 low = fminf(sweep_min[axis], stationary_min[axis]);
+            f32 high = fmaxf(sweep_max[axis], stationary_max[axis]);
+            min[axis] = j == 0 ? low : fminf(min[axis], low);
+            max[axis] = j == 0 ? high : fmaxf(max[axis], high);
+        }
+    }
 }
 
-void physics_reset(void) {
-    state.static_body_list->len = 0;
-    state.body_list->len = 0;
+// Second parallel pass. Finds the contacts between bodies from the recorded
+// positions, in the order a serial update finds them.
+static void contact_job(u32 thread_index, u32 thread_count, void *data) {
+    Physics_Scratch *scratch = scratch_get(thread_index);
+    u8 *stepped = state.stepped_list->items;
+    u32 first, last;
+    job_range(&first, &last, state.stepped_list->len, thread_index, thread_count);
+
+    for (u32 i = first; i < last; i++) {
+        if (!stepped[i]) {
+            continue;
+        }
+
+        Body *body = body_get(i);
+        bool has_on_hit = body_callbacks_get(i)->on_hit != NULL;
+        u32 substep_count = state.lanes.substep_count[i];
+        vec2 scaled_velocity;
+        substep_velocity(scaled_velocity, i);
+        Substep_Record *substeps = (Substep_Record*)state.substep_list->items + i * state.max_substeps;
+
+        if (has_on_hit) {
+            vec2 min, max;
+            substep_region(min, max, body, substeps, substep_count, scaled_velocity);
+            step_bodies_gather(scratch, body, min, max);
+        }
+
+        for (u32 j = 0; j < substep_count; j++) {
+            if (substeps[j].static_hit.is_hit && body_callbacks_get(i)->on_hit_static != NULL) {
+                contact_append(scratch, i, CONTACT_KIND_STATIC, substeps[j].static_hit);
+            }
+
+            if (has_on_hit) {
+                overlap_bodies(scratch, body, i, substeps[j].stationary_position, true);
+
+                u32 *candidates = scratch->candidate_list->items;
+                for (size_t k = 0; k < scratch->candidate_list->len; k++) {
+                    contact_append(scratch, i, CONTACT_KIND_BODY, (Hit){.is_hit = true, .other_id = candidates[k]});
+                }
+            }
+        }
+
+        step_candidates_end(scratch);
+    }
+}
+
+// Grid for the contact pass, covering both where each body started and where
+// it ended up.
+static void build_contact_broadphase(void) {
+    u32 body_count = state.body_list->len;
+    u8 *stepped = state.stepped_list->items;
+    broadphase_grid_begin(&state.grid, body_count);
+
+    for (u32 i = 0; i < body_count; i++) {
+        Body *body = body_get(i);
+
+        if (!body->is_active || body->collision_layer == 0) {
+            continue;
+        }
+
+        vec2 min, max;
+        aabb_min_max(min, max, body->aabb);
+
+        if (stepped[i]) {
+            Substep_Record *substep = (Substep_Record*)state.substep_list->items + i * state.max_substeps;
+            for (u8 axis = 0; axis < 2; axis++) {
+                min[axis] = fminf(min[axis], substep->sweep_position[axis] - body->aabb.half_size[axis]);
+                max[axis] = fmaxf(max[axis], substep->sweep_position[axis] + body->aabb.half_size[axis]);
+            }
+        }
+
+        vec2_sub(min, min, (vec2){BROADPHASE_MARGIN, BROADPHASE_MARGIN});
+        vec2_add(max, max, (vec2){BROADPHASE_MARGIN, BROADPHASE_MARGIN});
+
+        broadphase_grid_insert(&state.grid, i, body->collision_layer, min, max);
+    }
+
+    broadphase_grid_end(&state.grid);
+}
+
+// Steps the bodies on all worker threads. Contacts are found against the
+// same positions a serial update would see, and in the same order.
+static void step_bodies_parallel(void) {
+    u32 body_count = state.body_list->len;
+    physics_list_resize(state.stepped_list, body_count);
+    physics_list_resize(state.substep_list, body_count * state.max_substeps);
+
+    // Queries build dirty trees, which can't happen on several threads.
+    static_trees_build();
+
+    physics_workers_run(&state.workers, move_job, NULL);
+    build_contact_broadphase();
+    physics_workers_run(&state.workers, contact_job, NULL);
+}
+
+// Calls the callbacks for the contact events of the last step, once nothing
+// is iterating the bodies anymore. The bodies are looked up by handles taken
+// before the first callback, so a body a callback destroyed gets no more
+// events, and neither does a body a callback created in its slot.
+static void dispatch_contacts(void) {
+    Array_List *event_list = state.contact_cache.event_list;
+    Array_List *handle_list = state.event_handle_list;
+
+    handle_list->len = 0;
+    Handle *handles = handle_list_emplace_n(handle_list, event_list->len * 2);
+    for (size_t i = 0; i < event_list->len; i++) {
+        Contact event = ((Contact*)event_list->items)[i];
+        handles[i * 2] = slot_map_handle(state.body_map, event.body_id);
+        handles[i * 2 + 1] = event.kind == CONTACT_KIND_BODY ? slot_map_handle(state.body_map, event.other_id) : HANDLE_NONE;
+    }
+
+    for (size_t i = 0; i < event_list->len; i++) {
+        // The events belong to a world that is about to be reset.
+        if (state.is_reset_pending) {
+            break;
+        }
+
+        Contact event = ((Contact*)event_list->items)[i];
+        Body *body = physics_body_get(handles[i * 2]);
+
+        if (!body) {
+            continue;
+        }
+
+        Body_Callbacks *callbacks = body_callbacks_get(event.body_id);
+
+        if (event.kind == CONTACT_KIND_BODY && callbacks->on_hit != NULL) {
+            Body *other = physics_body_get(handles[i * 2 + 1]);
+            if (other) {
+                callbacks->on_hit(body, other, event.hit);
+            }
+        } else if (event.kind == CONTACT_KIND_STATIC && callbacks->on_hit_static != NULL && event.other_id < state.static_body_list->len) {
+            callbacks->on_hit_static(body, physics_static_body_get(event.other_id), event.hit);
+        }
+    }
+}
+
+// Checks the triggers against where the bodies ended up and calls back for
+// the bodies that entered or left them.
+static void update_triggers(void) {
+    Trigger_Store *triggers = &state.triggers;
+    if (triggers->trigger_list->len == 0 && triggers->pair_list->len == 0) {
+        return;
+    }
+
+    Physics_Scratch *scratch = scratch_get(0);
+    trigger_store_update(triggers, &state.grid, &scratch->query, state.body_list, scratch->candidate_list);
+
+    // Handles taken up front, as in dispatch_contacts.
+    Array_List *handle_list = state.event_handle_list;
+    handle_list->len = 0;
+    Handle *handles = handle_list_emplace_n(handle_list, triggers->event_list->len);
+    for (size_t i = 0; i < triggers->event_list->len; i++) {
+        handles[i] = slot_map_handle(state.body_map, ((Trigger_Event*)triggers->event_list->items)[i].pair.body_id);
+    }
+
+    for (size_t i = 0; i < triggers->event_list->len; i++) {
+        if (state.is_reset_pending) {
+            break;
+        }
+
+        Trigger_Event event = ((Trigger_Event*)triggers->event_list->items)[i];
+        On_Trigger on_trigger = trigger_store_callback(triggers, event.pair.trigger_id);
+        Body *body = physics_body_get(handles[i]);
+
+        if (on_trigger != NULL && body) {
+            on_trigger(physics_trigger_get(event.pair.trigger_id), body, event.contact);
+        }
+    }
+}
+
+// A sleeping body wakes once anything outside of physics moved it or gave it
+// a velocity. Checked before the previous positions are overwritten.
+static void wake_changed_bodies(void) {
+    vec2 *previous_positions = state.previous_position_list->items;
+
+    for (u32 i = 0; i < state.body_list->len; ++i) {
+        Body *body = body_get(i);
+
+        if (!body->is_active || !body->is_sleeping) {
+            continue;
+        }
+
+        if (body->velocity[0] != 0 || body->velocity[1] != 0 ||
+            body->acceleration[0] != 0 || body->acceleration[1] != 0 ||
+            body->aabb.position[0] != previous_positions[i][0] || body->aabb.position[1] != previous_positions[i][1]) {
+            body_wake(i);
+        }
+    }
+}
+
+static bool body_is_still(Body *body, u32 body_id) {
+    f32 *previous_position = ((vec2*)state.previous_position_list->items)[body_id];
+
+    return fabsf(body->aabb.position[0] - previous_position[0]) <= PHYSICS_SLEEP_DISTANCE &&
+           fabsf(body->aabb.position[1] - previous_position[1]) <= PHYSICS_SLEEP_DISTANCE &&
+           fabsf(body->velocity[0]) <= PHYSICS_SLEEP_VELOCITY &&
+           fabsf(body->velocity[1]) <= PHYSICS_SLEEP_VELOCITY &&
+           body->acceleration[0] == 0 && body->acceleration[1] == 0;
+}
+
+static bool bodies_interact(Body *a, Body *b) {
+    return (a->collision_mask & b->collision_layer) != 0 || (b->collision_mask & a->collision_layer) != 0;
+}
+
+// Wakes the sleeping bodies overlapping body. Either mask may select the
+// other, so every layer is visited.
+static void wake_touching_bodies(Physics_Scratch *scratch, Body *body) {
+    vec2 min, max;
+    aabb_min_max(min, max, body->aabb);
+    broadphase_grid_query(&state.grid, &scratch->query, 0xFF, min, max, state.body_list->len, scratch->candidate_list);
+
+    u32 *candidates = scratch->candidate_list->items;
+    for (size_t i = 0; i < scratch->candidate_list->len; i++) {
+        Body *other = body_get(candidates[i]);
+
+        if (other->is_sleeping && bodies_interact(body, other) && physics_aabb_intersect_aabb(body->aabb, other->aabb)) {
+            body_wake(candidates[i]);
+        }
+    }
+}
+
+// Puts bodies that stayed still for long enough to sleep. Bodies with an
+// on_hit callback stay awake, since only they notice what overlaps them.
+static void update_sleep(void) {
+    u16 *still_steps = state.still_step_list->items;
+    u32 sleeping_count = 0;
+
+    for (u32 i = 0; i < state.body_list->len; ++i) {
+        Body *body = body_get(i);
+
+        if (!body->is_active) {
+            continue;
+        }
+
+        if (body->is_sleeping) {
+            sleeping_count++;
+            continue;
+        }
+
+        // Bodies left for a later step haven't had the chance to move.
+        if (i >= state.lanes.count || !state.lanes.is_integrated[i]) {
+            continue;
+        }
+
+        if (!body_is_still(body, i) || body_callbacks_get(i)->on_hit != NULL) {
+            still_steps[i] = 0;
+            continue;
+        }
+
+        if (++still_steps[i] >= PHYSICS_SLEEP_STEPS) {
+            body->is_sleeping = true;
+            body->velocity[0] = 0;
+            body->velocity[1] = 0;
+            sleeping_count++;
+        }
+    }
+
+    if (sleeping_count == 0) {
+        return;
+    }
+
+    for (u32 i = 0; i < state.body_list->len; ++i) {
+        Body *body = body_get(i);
+
+        if (body->is_active && !body->is_sleeping && still_steps[i] == 0) {
+            wake_touching_bodies(scratch_get(0), body);
+        }
+    }
+}
+
+// Wakes the sleeping bodies touching aabb, used when static bodies change.
+static void wake_bodies_near(AABB aabb) {
+    aabb.half_size[0] += BROADPHASE_MARGIN;
+    aabb.half_size[1] += BROADPHASE_MARGIN;
+
+    for (u32 i = 0; i < state.body_list->len; ++i) {
+        Body *body = body_get(i);
+
+        if (body->is_active && body->is_sleeping && physics_aabb_intersect_aabb(aabb, body->aabb)) {
+            body_wake(i);
+        }
+    }
+}
+
+void physics_body_wake(Handle body_id) {
+    if (physics_body_get(body_id)) {
+        body_wake(handle_slot(body_id));
+    }
+}
+
+// Decides how many steps each body advances by in this step. Bodies
+// outside the LOD region take their turn every lod_interval steps,
+// staggered by id so they don't all land on the same step. Every body is
+// loaded here anyway, so its lanes for integration are filled in as well.
+static void weigh_bodies(void) {
+    physics_list_resize(state.step_weight_list, state.body_list->len);
+    body_lanes_begin(&state.lanes, state.body_list->len);
+    u16 *weights = state.step_weight_list->items;
+    u16 *skipped = state.lod_skip_list->items;
+
+    for (u32 i = 0; i < state.body_list->len; ++i) {
+        Body *body = body_get(i);
+        bool is_due = state.lod_interval <= 1 ||
+            !body->is_active ||
+            body->is_sleeping ||
+            (state.step_index + i) % state.lod_interval == 0 ||
+            physics_aabb_intersect_aabb(body->aabb, state.lod_region);
+
+        if (is_due) {
+            weights[i] = skipped[i] + 1;
+            skipped[i] = 0;
+        } else {
+            weights[i] = 0;
+            skipped[i]++;
+        }
+
+        body_lanes_set(&state.lanes, i, body, weights[i]);
+    }
+
+    state.step_index++;
+}
+
+void physics_step(void) {
+    state.is_stepping = true;
+    wake_changed_bodies();
+    weigh_bodies();
+
+    // Kept for interpolating between the last two steps.
+    vec2 *previous_positions = state.previous_position_list->items;
+    for (u32 i = 0; i < state.body_list->len; ++i) {
+        vec2_dup(previous_positions[i], body_get(i)->aabb.position);
+    }
+
+    integrate_bodies(&state.lanes, state.body_list, state.gravity, state.terminal_velocity, state.step_delta, state.max_substeps);
+    build_broadphase();
+
+    for (u32 t = 0; t < state.workers.thread_count; t++) {
+        scratch_get(t)->contact_list->len = 0;
+    }
+
+    // Only reads the state from before anything moves.
+    physics_workers_run(&state.workers, sweep_bodies_job, NULL);
+    move_maskless_bodies(&state.lanes, state.body_list);
+
+    for (u32 i = 0; i < state.lanes.count; ++i) {
+        if (body_is_stepped(i)) {
+            state.substep_total += state.lanes.substep_count[i];
+        }
+    }
+
+    if (state.workers.thread_count > 1) {
+        step_bodies_parallel();
+    } else {
+        for (u32 i = 0; i < state.body_list->len; ++i) {
+            if (body_is_stepped(i)) {
+                step_body(scratch_get(0), i);
+            }
+        }
+    }
+
+    contact_cache_begin(&state.contact_cache);
+    for (u32 t = 0; t < state.workers.thread_count; t++) {
+        contact_cache_add(&state.contact_cache, scratch_get(t)->contact_list);
+    }
+    contact_cache_end(&state.contact_cache, state.body_list, state.lanes.is_integrated);
+
+    update_sleep();
+    dispatch_contacts();
+    update_triggers();
+    state.is_stepping = false;
+
+    if (state.is_reset_pending) {
+        state.is_reset_pending = false;
+        physics_reset();
+    }
+}
+
+// Runs as many fixed steps as delta seconds cover, carrying the remainder
+// over to the next frame. Returns the number of steps run.
+u32 physics_update(f32 delta) {
+    u32 step_count = 0;
+    u32 reset_count = state.reset_count;
+    state.substep_total = 0;
+    state.accumulator += delta;
+
+    while (state.accumulator >= state.step_delta && step_count < state.max_steps) {
+        physics_step();
+        step_count++;
+
+        // A callback reset the physics, which starts the accumulator over,
+        // so there is nothing left to catch up on.
+        if (state.reset_count != reset_count) {
+            break;
+        }
+
+        state.accumulator -= state.step_delta;
+    }
+
+    if (state.accumulator >= state.step_delta) {
+        state.accumulator = fmodf(state.accumulator, state.step_delta);
+    }
+
+    // Keeps physics_alpha within [0, 1].
+    if (state.accumulator < 0) {
+        state.accumulator = 0;
+    }
+
+    return step_count;
+}
+
+// How far the time left over in the accumulator is into the next step.
+f32 physics_alpha(void) {
+    return state.accumulator / state.step_delta;
+}
+
+// Position of the body between the last two steps, for rendering.
+void physics_body_position_interpolated(vec2 result, Handle body_id) {
+    Body *body = physics_body_get(body_id);
+    if (!body) {
+        ERROR_EXIT("Body handle %" PRIx64 " is stale\n", body_id);
+    }
+
+    f32 *previous_position = ((vec2*)state.previous_position_list->items)[handle_slot(body_id)];
+    f32 alpha = physics_alpha();
+
+    result[0] = previous_position[0] + (body->aabb.position[0] - previous_position[0]) * alpha;
+    result[1] = previous_position[1] + (body->aabb.position[1] - previous_position[1]) * alpha;
+}
+
+Handle physics_body_create(vec2 position, vec2 size, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static, Handle entity_id) {
+    Handle handle = slot_map_insert(state.body_map, &(Body){0});
+    u32 id = handle_slot(handle);
+
+    // The lists indexed by body grow along with the slots.
+    if (id == state.body_callback_id_list->len) {
+        if (array_list_append(state.body_callback_id_list, &(u32){0}) == (size_t)-1) {
+            ERROR_EXIT("Could not append body callbacks to list\n");
+        }
+
+        if (array_list_append(state.previous_position_list, &(vec2){0}) == (size_t)-1) {
+            ERROR_EXIT("Could not append previous position to list\n");
+        }
+
+        if (array_list_append(state.still_step_list, &(u16){0}) == (size_t)-1) {
+            ERROR_EXIT("Could not append still steps to list\n");
+        }
+
+        if (array_list_append(state.lod_skip_list, &(u16){0}) == (size_t)-1) {
+            ERROR_EXIT("Could not append skipped steps to list\n");
+        }
+    } else {
+        // A reused slot must not report the contacts of its previous body.
+        contact_cache_remove_body(&state.contact_cache, id);
+        trigger_store_remove_body(&state.triggers, id);
+    }
+
+    ((u32*)state.body_callback_id_list->items)[id] = body_callbacks_id(on_hit, on_hit_static);
+
+    Body *body = body_get(id);
+
+    *body = (Body){
+        .aabb = {
+            .position = { position[0], position[1] },
+            .half_size = { size[0] * 0.5, size[1] * 0.5 },
+        },
+        .velocity = { velocity[0], velocity[1] },
+        .collision_layer = collision_layer,
+        .collision_mask = collision_mask,
+        .is_kinematic = is_kinematic,
+        .is_active = true,
+        .entity_id = entity_id
+    };
+
+    vec2_dup(((vec2*)state.previous_position_list->items)[id], body->aabb.position);
+    ((u16*)state.still_step_list->items)[id] = 0;
+    ((u16*)state.lod_skip_list->items)[id] = 0;
+
+    return handle;
+}
+
+// Makes room for count more bodies, so creating them won't grow any of the
+// lists indexed by body.
+void physics_body_reserve(size_t count) {
+    slot_map_reserve(state.body_map, count);
+    array_list_reserve(state.body_callback_id_list, count);
+    array_list_reserve(state.previous_position_list, count);
+    array_list_reserve(state.still_step_list, count);
+    array_list_reserve(state.lod_skip_list, count);
+}
+
+// Creates count bodies alike but for their position, growing the lists at
+// most once. body_ids receives their handles and entity_ids gives the
+// entity of each, either may be NULL.
+void physics_body_create_batch(Handle *body_ids, vec2 *positions, size_t count, vec2 size, vec2 velocity, u8 collision_layer, u8 collision_mask, bool is_kinematic, On_Hit on_hit, On_Hit_Static on_hit_static, Handle *entity_ids) {
+    physics_body_reserve(count);
+
+    for (size_t i = 0; i < count; i++) {
+        Handle entity_id = entity_ids ? entity_ids[i] : HANDLE_NONE;
+        Handle body_id = physics_body_create(positions[i], size, velocity, collision_layer, collision_mask, is_kinematic, on_hit, on_hit_static, entity_id);
+
+        if (body_ids) {
+            body_ids[i] = body_id;
+        }
+    }
+}
+
+// Frees the slot of the body for reuse. Does nothing if it was already
+// destroyed.
+void physics_body_destroy(Handle body_id) {
+    Body *body = physics_body_get(body_id);
+
+    if (body) {
+        body->is_active = false;
+        slot_map_remove(state.body_map, body_id);
+    }
+}
+
+// Handle of the body in slot index, as found by the queries, or HANDLE_NONE
+// if there is none.
+Handle physics_body_handle(size_t index) {
+    return slot_map_handle(state.body_map, (u32)index);
+}
+
+Body *physics_body_get(Handle body_id) {
+    return slot_map_get(state.body_map, body_id);
+}
+
+size_t physics_trigger_create(vec2 position, vec2 size, u8 collision_mask, On_Trigger on_trigger) {
+    AABB aabb = {
+        .position = { position[0], position[1] },
+        .half_size = { size[0] * 0.5, size[1] * 0.5 },
+    };
+
+    return trigger_store_create(&state.triggers, aabb, collision_mask, on_trigger);
+}
+
+Trigger *physics_trigger_get(size_t index) {
+    return array_list_get(state.triggers.trigger_list, index);
+}
+
+size_t physics_static_body_create(vec2 position, vec2 size, u8 collision_layer) {
+    Static_Body static_body = {
+        .aabb = {
+            .position = { position[0], position[1] },
+            .half_size = { size[0] * 0.5, size[1] * 0.5 },
+        },
+        .collision_layer = collision_layer,
+    };
+
+    if (array_list_append(state.static_body_list, &static_body) == (size_t)-1)
+        ERROR_EXIT("Could not append static body to list\n");
+
+    static_trees_mark_dirty();
+    wake_bodies_near(static_body.aabb);
+
+    return state.static_body_list->len - 1;
+}
+
+// Moves or resizes a static body. Bodies sleeping on or next to it, before
+// or after the change, are woken.
+void physics_static_body_set(size_t index, vec2 position, vec2 size) {
+    Static_Body *static_body = physics_static_body_get(index);
+    wake_bodies_near(static_body->aabb);
+
+    static_body->aabb = (AABB){
+        .position = { position[0], position[1] },
+        .half_size = { size[0] * 0.5, size[1] * 0.5 },
+    };
+
+    static_trees_mark_dirty();
+    wake_bodies_near(static_body->aabb);
+}
+
+// Merges the static bodies into the fewest boxes covering the same area on
+// each layer. Meant to run once the level is built. Static bodies that
+// aren't merged keep their order, shifted down only past the ones merged
+// away, and a merged box takes the place of the first body it covers.
+// Contacts carry over to the box, so bodies resting on it see no new enter
+// event.
+size_t physics_static_body_coalesce(void) {
+    // Without a frame arena the scratch memory is freed right away.
+    Arena scratch_arena;
+    Arena *arena = state.frame_arena;
+    if (!arena) {
+        arena_init(&scratch_arena, 0);
+        arena = &scratch_arena;
+    }
+
+    u32 *remap = arena_alloc(arena, state.static_body_list->len * sizeof(u32));
+    size_t count = static_bodies_coalesce(state.static_body_list, remap, arena);
+
+    contact_cache_remap_statics(&state.contact_cache, remap);
+
+    if (arena == &scratch_arena) {
+        arena_release(&scratch_arena);
+    }
+
+    static_trees_mark_dirty();
+
+    return count;
+}
+
+Static_Body *physics_static_body_get(size_t index) {
+    return array_list_get(state.static_body_list, index);
+}
+
+size_t physics_static_body_count() {
+    return state.static_body_list->len;
+}
+
+// Saves bodies, static bodies, triggers and their contacts into snapshot,
+// an Array_List of bytes, and returns its size. The bytes can be copied
+// anywhere as long as they stay 8 byte aligned. Body and trigger callbacks
+// are saved as ids, so a snapshot restores in another run only if the same
+// callbacks were first used in the same order.
+size_t physics_snapshot_save(Array_List *snapshot) {
+    snapshot_write(&state, snapshot);
+    return snapshot->len;
+}
+
+void physics_snapshot_restore(const void *snapshot) {
+    if (snapshot_read(&state, snapshot)) {
+        static_trees_mark_dirty();
+    }
+
+    clear_broadphase();
+}
+
+// Saves only what changed since base, a snapshot saved earlier.
+size_t physics_snapshot_save_delta(Array_List *delta, const void *base) {
+    snapshot_write(&state, state.snapshot_scratch);
+    snapshot_delta_write(delta, state.snapshot_scratch->items, base);
+    return delta->len;
+}
+
+// Restores a delta saved against base.
+void physics_snapshot_restore_delta(const void *delta, const void *base) {
+    snapshot_delta_apply(state.snapshot_scratch, delta, base);
+    physics_snapshot_restore(state.snapshot_scratch->items);
+}
+
+// Size in bytes of a snapshot or delta.
+size_t physics_snapshot_size(const void *snapshot) {
+    return snapshot_size(snapshot);
+}
+
+// Replaces list with an empty one in the level arena. Only the lists made
+// before there was an arena need freeing, the others went with the arena.
+static Array_List *level_list_create(Array_List *list, bool is_in_arena, size_t item_size) {
+    if (!is_in_arena) {
+        free(list->items);
+        free(list);
+    }
+
+    return array_list_create_in(state.level_arena, item_size, 0);
+}
+
+// Empties the physics and releases the level arena. When a callback calls
+// this during a step, the reset waits until the step is over, because the
+// step is still going through the lists that the reset frees.
+void physics_reset(void) {
+    if (state.is_stepping) {
+        state.is_reset_pending = true;
+        return;
+    }
+
+    // The lists in the level arena go with it and are made again.
+    if (state.level_arena) {
+        arena_release(state.level_arena);
+        bool is_in_arena = state.is_level_in_arena;
+        state.static_body_list = level_list_create(state.static_body_list, is_in_arena, sizeof(Static_Body));
+        state.triggers.trigger_list = level_list_create(state.triggers.trigger_list, is_in_arena, sizeof(Trigger));
+        state.triggers.callback_id_list = level_list_create(state.triggers.callback_id_list, is_in_arena, sizeof(u32));
+        state.is_level_in_arena = true;
+    }
+
+    state.static_body_list->len = 0;
+    slot_map_clear(state.body_map);
+    state.body_callback_id_list->len = 0;
+    state.previous_position_list->len = 0;
+    state.still_step_list->len = 0;
+    state.lod_skip_list->len = 0;
+    contact_cache_reset(&state.contact_cache);
+    trigger_store_reset(&state.triggers);
+    state.lanes.count = 0;
+    state.accumulator = 0;
+    state.substep_total = 0;
+    state.reset_count++;
+    static_trees_mark_dirty();
+    clear_broadphase();
+    sap_clear(&state.sap);
+}
+
+// Hash of the position, size and velocity of every active body, for
+// comparing runs that should have ended up in the same state.
+u64 physics_state_hash(void) {
+    u64 hash = 14695981039346656037ull;
+
+    for (u32 i = 0; i < state.body_list->len; ++i) {
+        Body *body = body_get(i);
+
+        if (!body->is_active) {
+            continue;
+        }
+
+        u32 bits[7] = {i};
+        memcpy(bits + 1, body->aabb.position, sizeof(vec2));
+        memcpy(bits + 3, body->aabb.half_size, sizeof(vec2));
+        memcpy(bits + 5, body->velocity, sizeof(vec2));
+
+        for (u32 j = 0; j < 7; j++) {
+            hash = (hash ^ bits[j]) * 1099511628211ull;
+        }
+    }
+
+    return hash;
+}
+
+// Queries run against the grid and trees of the last step, so bodies moved
+// directly since then are found where the step left them. Bodies created
+// since are always checked.
+
+static Raycast_Hit raycast(Physics_Scratch *scratch, vec2 origin, vec2 magnitude, u8 collision_mask) {
+    AABB ray = {.position = {origin[0], origin[1]}};
+    vec2 min, max;
+    swept_min_max(min, max, ray, magnitude);
+
+    query_static_bodies(scratch, min, max, collision_mask);
+    sweep_boxes_clear(&scratch->sweep_boxes);
+
+    u32 *static_candidates = scratch->static_candidate_list->items;
+    for (size_t i = 0; i < scratch->static_candidate_list->len; i++) {
+        Static_Body *static_body = physics_static_body_get(static_candidates[i]);
+
+        if ((collision_mask & static_body->collision_layer) != 0) {
+            sweep_boxes_push(&scratch->sweep_boxes, static_candidates[i], static_body->aabb, (vec2){0, 0});
+        }
+    }
+
+    Hit static_hit = sweep_boxes_result(&scratch->sweep_boxes, origin, magnitude);
+
+    broadphase_grid_query(&state.grid, &scratch->query, collision_mask, min, max, state.body_list->len, scratch->candidate_list);
+    sweep_boxes_clear(&scratch->sweep_boxes);
+
+    u32 *candidates = scratch->candidate_list->items;
+    for (size_t i = 0; i < scratch->candidate_list->len; i++) {
+        Body *body = body_get(candidates[i]);
+
+        if (body->is_active && (collision_mask & body->collision_layer) != 0) {
+            sweep_boxes_push(&scratch->sweep_boxes, candidates[i], body->aabb, (vec2){0, 0});
+        }
+    }
+
+    Hit body_hit = sweep_boxes_result(&scratch->sweep_boxes, origin, magnitude);
+
+    // Static bodies win ties, so a body flush against a wall is out of sight.
+    if (body_hit.is_hit && (!static_hit.is_hit || body_hit.time < static_hit.time)) {
+        return (Raycast_Hit){.hit = body_hit, .body_id = slot_map_handle(state.body_map, body_hit.other_id)};
+    }
+
+    return (Raycast_Hit){.hit = static_hit, .body_id = HANDLE_NONE, .is_static = static_hit.is_hit};
+}
+
+static size_t overlap_aabb(Physics_Scratch *scratch, AABB aabb, u8 collision_mask, Array_List *result_list) {
+    vec2 min, max;
+    aabb_min_max(min, max, aabb);
+    broadphase_grid_query(&state.grid, &scratch->query, collision_mask, min, max, state.body_list->len, scratch->candidate_list);
+
+    size_t count = 0;
+    u32 *candidates = scratch->candidate_list->items;
+    for (size_t i = 0; i < scratch->candidate_list->len; i++) {
+        Body *body = body_get(candidates[i]);
+
+        if (!body->is_active || (collision_mask & body->collision_layer) == 0 || !physics_aabb_intersect_aabb(aabb, body->aabb)) {
+            continue;
+        }
+
+        handle_list_append(result_list, slot_map_handle(state.body_map, candidates[i]));
+        count++;
+    }
+
+    return count;
+}
+
+static Handle query_nearest(Physics_Scratch *scratch, vec2 point, f32 max_distance, u8 collision_mask) {
+    vec2 min = {point[0] - max_distance, point[1] - max_distance};
+    vec2 max = {point[0] + max_distance, point[1] + max_distance};
+    broadphase_grid_query(&state.grid, &scratch->query, collision_mask, min, max, state.body_list->len, scratch->candidate_list);
+
+    size_t nearest_id = (size_t)-1;
+    f32 nearest_distance = INFINITY;
+    f32 max_distance_squared = max_distance * max_distance;
+
+    // Candidates are in ascending order, the lowest id wins a tie.
+    u32 *candidates = scratch->candidate_list->items;
+    for (size_t i = 0; i < scratch->candidate_list->len; i++) {
+        Body *body = body_get(candidates[i]);
+
+        if (!body->is_active || (collision_mask & body->collision_layer) == 0) {
+            continue;
+        }
+
+        vec2 offset;
+        vec2_sub(offset, body->aabb.position, point);
+        f32 distance = offset[0] * offset[0] + offset[1] * offset[1];
+
+        if (distance <= max_distance_squared && distance < nearest_distance) {
+            nearest_id = candidates[i];
+            nearest_distance = distance;
+        }
+    }
+
+    return nearest_id == (size_t)-1 ? HANDLE_NONE : slot_map_handle(state.body_map, (u32)nearest_id);
+}
+
+// Closest body or static body whose layer is in collision_mask along the ray
+// from origin to origin + magnitude.
+Raycast_Hit physics_raycast(vec2 origin, vec2 magnitude, u8 collision_mask) {
+    return raycast(scratch_get(0), origin, magnitude, collision_mask);
+}
+
+// Appends the handle of every active body overlapping aabb whose layer is
+// in collision_mask to result_list, which holds Handle. Returns how many
+// were appended.
+size_t physics_overlap_aabb(AABB aabb, u8 collision_mask, Array_List *result_list) {
+    return overlap_aabb(scratch_get(0), aabb, collision_mask, result_list);
+}
+
+// Body whose center is closest to point and no further than max_distance,
+// or HANDLE_NONE if there is none. max_distance must be finite.
+Handle physics_query_nearest(vec2 point, f32 max_distance, u8 collision_mask) {
+    return query_nearest(scratch_get(0), point, max_distance, collision_mask);
+}
+
+typedef struct query_batch {
+    u32 count;
+    vec2 *origins;
+    vec2 *magnitudes;
+    AABB *aabbs;
+    f32 max_distance;
+    u8 collision_mask;
+    Raycast_Hit *raycast_results;
+    u32 *overlap_counts;
+    Handle *nearest_results;
+} Query_Batch;
+
+static void raycast_job(u32 thread_index, u32 thread_count, void *data) {
+    Query_Batch *batch = data;
+    u32 first, last;
+    job_range(&first, &last, batch->count, thread_index, thread_count);
+
+    for (u32 i = first; i < last; i++) {
+        batch->raycast_results[i] = raycast(scratch_get(thread_index), batch->origins[i], batch->magnitudes[i], batch->collision_mask);
+    }
+}
+
+// Each thread appends to its own list, in the order of its queries.
+static void overlap_aabb_job(u32 thread_index, u32 thread_count, void *data) {
+    Query_Batch *batch = data;
+    Physics_Scratch *scratch = scratch_get(thread_index);
+    u32 first, last;
+    job_range(&first, &last, batch->count, thread_index, thread_count);
+
+    scratch->overlap_list->len = 0;
+    for (u32 i = first; i < last; i++) {
+        batch->overlap_counts[i] = (u32)overlap_aabb(scratch, batch->aabbs[i], batch->collision_mask, scratch->overlap_list);
+    }
+}
+
+static void query_nearest_job(u32 thread_index, u32 thread_count, void *data) {
+    Query_Batch *batch = data;
+    u32 first, last;
+    job_range(&first, &last, batch->count, thread_index, thread_count);
+
+    for (u32 i = first; i < last; i++) {
+        batch->nearest_results[i] = query_nearest(scratch_get(thread_index), batch->origins[i], batch->max_distance, batch->collision_mask);
+    }
+}
+
+// Runs count raycasts, split across the physics threads.
+void physics_raycast_batch(u32 count, vec2 *origins, vec2 *magnitudes, u8 collision_mask, Raycast_Hit *results) {
+    Query_Batch batch = {
+        .count = count,
+        .origins = origins,
+        .magnitudes = magnitudes,
+        .collision_mask = collision_mask,
+        .raycast_results = results,
+    };
+
+    static_trees_build();
+    physics_workers_run(&state.workers, raycast_job, &batch);
+}
+
+// Appends the overlaps of every aabb to result_list one query after the
+// other, with the number found for aabbs[i] in result_counts[i]. The
+// queries are split across the physics threads. Every thread covers a run
+// of consecutive queries, so joining their lists in thread order keeps the
+// order of the queries.
+void physics_overlap_aabb_batch(u32 count, AABB *aabbs, u8 collision_mask, Array_List *result_list, u32 *result_counts) {
+    Query_Batch batch = {
+        .count = count,
+        .aabbs = aabbs,
+        .collision_mask = collision_mask,
+        .overlap_counts = result_counts,
+    };
+
+    physics_workers_run(&state.workers, overlap_aabb_job, &batch);
+
+    for (u32 i = 0; i < state.workers.thread_count; i++) {
+        Array_List *overlap_list = scratch_get(i)->overlap_list;
+        array_list_append_n(result_list, overlap_list->items, overlap_list->len);
+    }
+}
+
+// Runs count nearest queries, split across the physics threads.
+void physics_query_nearest_batch(u32 count, vec2 *points, f32 max_distance, u8 collision_mask, Handle *results) {
+    Query_Batch batch = {
+        .count = count,
+        .origins = points,
+        .max_distance = max_distance,
+        .collision_mask = collision_mask,
+        .nearest_results = results,
+    };
+
+    physics_workers_run(&state.workers, query_nearest_job, &batch);
 }
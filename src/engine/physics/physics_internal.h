@@ -1,11 +1,426 @@
 #pragma once
 
+#include <stdbool.h>
+#include <linmath.h>
+
 #include "../array_list.h"
+#include "../physics.h"
 #include "../types.h"
 
+// Must be a power of two.
+#define BROADPHASE_MIN_BUCKET_COUNT 1024
+#define BROADPHASE_CELL_SIZE 64
+#define BROADPHASE_MARGIN 1
+#define BROADPHASE_MAX_OVERFLOW 64
+
+// One bucket per bit of a collision layer.
+#define PHYSICS_LAYER_COUNT 8
+// Static bodies are kept in one tree per layer bit, plus one for those
+// without a layer.
+#define STATIC_TREE_COUNT (PHYSICS_LAYER_COUNT + 1)
+#define STATIC_TREE_LAYERLESS PHYSICS_LAYER_COUNT
+#define STATIC_TREE_ALL ((1u << STATIC_TREE_COUNT) - 1)
+
+#define PHYSICS_DEFAULT_STEP_RATE 60
+#define PHYSICS_DEFAULT_MAX_STEPS 5
+#define PHYSICS_DEFAULT_MAX_SUBSTEPS 8
+
+// A body that moves less than this for PHYSICS_SLEEP_STEPS steps in a row
+// goes to sleep.
+#define PHYSICS_SLEEP_DISTANCE 0.01f
+#define PHYSICS_SLEEP_VELOCITY 0.01f
+#define PHYSICS_SLEEP_STEPS 30
+
+#ifdef PHYSICS_FIXED_POINT
+#include <math.h>
+
+// 16.16 fixed point. Building with PHYSICS_FIXED_POINT runs the AABB tests,
+// sweeps, penetration vectors and integration on these, so results are the
+// same on every machine and at every optimization level. Bodies still store
+// f32 and are converted on the way in and out, which limits coordinates to
+// +-32767.
+typedef i32 Fixed;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define FIXED_MAX INT32_MAX
+#define FIXED_MIN (-INT32_MAX)
+
+static inline Fixed fixed_clamp(i64 value) {
+    return value > FIXED_MAX ? FIXED_MAX : value < FIXED_MIN ? FIXED_MIN : (Fixed)value;
+}
+
+// Scaling by a power of two is exact, so only the rounding to an integer
+// can differ, and lrintf always rounds to nearest even.
+static inline Fixed fixed_from_f32(f32 value) {
+    f32 scaled = value * FIXED_ONE;
+    if (!(scaled < (f32)FIXED_MAX)) {
+        return scaled != scaled ? 0 : FIXED_MAX;
+    }
+    if (!(scaled > (f32)FIXED_MIN)) {
+        return FIXED_MIN;
+    }
+
+    return (Fixed)lrintf(scaled);
+}
+
+static inline f32 fixed_to_f32(Fixed value) {
+    return (f32)value / FIXED_ONE;
+}
+
+static inline Fixed fixed_mul(Fixed a, Fixed b) {
+    return fixed_clamp(((i64)a * b) >> FIXED_SHIFT);
+}
+
+// Divides a difference of two values, which may not fit in a Fixed itself.
+static inline Fixed fixed_div(i64 a, Fixed b) {
+    return fixed_clamp(a * FIXED_ONE / b);
+}
+#endif
+
+typedef struct broadphase_entry {
+    i32 x;
+    i32 y;
+    u32 body_id;
+    u32 layer_bit;
+} Broadphase_Entry;
+
+ARRAY_LIST_DEFINE(broadphase_entry_list, Broadphase_Entry)
+
+// Uniform grid hashed into at least twice as many buckets as it has entries.
+// Cells are hashed together with a layer bit, so a query only visits the
+// buckets of the layers its mask selects. Rebuilt every frame from the swept AABBs of the bodies.
+// Bodies that leave the bounds they were inserted with are kept in an
+// overflow list that every query visits.
+typedef struct broadphase_grid {
+    f32 cell_size;
+    u32 body_count;
+    u32 bucket_count;
+    Array_List *bucket_start_list;
+    Array_List *entry_list;
+    Array_List *cell_body_list;
+    Array_List *bounds_list;
+    Array_List *overflow_list;
+} Broadphase_Grid;
+
+// Marks the bodies a query has already returned. Kept apart from the grid so
+// threads can query it at the same time.
+typedef struct broadphase_query {
+    Array_List *stamp_list;
+    u32 stamp;
+} Broadphase_Query;
+
+typedef struct sap_endpoint {
+    f32 value;
+    // Body id shifted left by one, with the lowest bit set for max endpoints.
+    u32 id;
+} Sap_Endpoint;
+
+// Sweep and prune over the same swept bounds as the grid. The endpoints of
+// each axis stay sorted from one step to the next, so insertion sort only
+// has to move the few that passed each other, and each of those swaps adds
+// or removes a pair in the pair set. Pairs are kept in an open addressing
+// table and listed per body after every update.
+typedef struct sweep_and_prune {
+    Array_List *endpoint_lists[2];
+    Array_List *bounds_list;
+    Array_List *pair_table;
+    Array_List *spare_table;
+    Array_List *neighbor_start_list;
+    Array_List *neighbor_list;
+    Array_List *active_list;
+    u32 body_count;
+    u32 pair_count;
+    u32 removed_count;
+} Sweep_And_Prune;
+
+typedef struct bvh_item {
+    vec2 min;
+    vec2 max;
+    u32 id;
+} Bvh_Item;
+
+// Internal nodes have a count of 0 and their children at first and first + 1.
+// Leaves own items first to first + count.
+typedef struct bvh_node {
+    vec2 min;
+    vec2 max;
+    u32 first;
+    u32 count;
+} Bvh_Node;
+
+// Bounding volume hierarchy over the static bodies of one layer bit, or
+// those without a layer when layer is STATIC_TREE_LAYERLESS. Built lazily on
+// the first query after the static bodies change.
+typedef struct bvh {
+    Array_List *node_list;
+    Array_List *item_list;
+    u32 layer;
+    bool is_dirty;
+} Bvh;
+
+// Callbacks are only needed when something is hit, so they are kept out of
+// Body to keep the per-frame passes over the body list compact.
+typedef struct body_callbacks {
+    On_Hit on_hit;
+    On_Hit_Static on_hit_static;
+} Body_Callbacks;
+
+// Velocity and acceleration of every body in structure of arrays form,
+// indexed by body id, which is what integration runs on. The lanes persist
+// between updates. Body keeps a mirror of them for game code, copied in with
+// body_lanes_set before integration and written back after it.
+typedef struct body_lanes {
+    u32 count;
+    u32 capacity;
+    f32 *velocity_x;
+    f32 *velocity_y;
+    f32 *acceleration_x;
+    f32 *acceleration_y;
+    f32 *step_x;
+    f32 *step_y;
+    f32 *step_weight;
+    u32 *dynamic_mask;
+    u32 *substep_count;
+    u8 *is_integrated;
+} Body_Lanes;
+
+// Picks up whatever game code wrote to the mirror in body since the last
+// step, along with the weight of this step. Called by weigh_bodies, which
+// loads every body anyway.
+static inline void body_lanes_set(Body_Lanes *lanes, u32 body_id, Body *body, u16 step_weight) {
+    lanes->velocity_x[body_id] = body->velocity[0];
+    lanes->velocity_y[body_id] = body->velocity[1];
+    lanes->acceleration_x[body_id] = body->acceleration[0];
+    lanes->acceleration_y[body_id] = body->acceleration[1];
+    lanes->step_weight[body_id] = step_weight;
+    lanes->dynamic_mask[body_id] = body->is_kinematic ? 0 : 0xFFFFFFFF;
+    lanes->is_integrated[body_id] = body->is_active && !body->is_sleeping && step_weight > 0;
+}
+
+// Candidates of a sweep packed for the batched ray test. The bounds are
+// already grown by the size of the swept body. Padded to a multiple of four.
+typedef struct sweep_boxes {
+    u32 count;
+    u32 capacity;
+    f32 *min_x;
+    f32 *min_y;
+    f32 *max_x;
+    f32 *max_y;
+    f32 *entry_time;
+    AABB *aabb;
+    u32 *id;
+    u32 *hit_index;
+} Sweep_Boxes;
+
+typedef enum contact_kind {
+    CONTACT_KIND_BODY,
+    CONTACT_KIND_STATIC,
+} Contact_Kind;
+
+// A body touching another body or a static body during a step.
+typedef struct contact {
+    u32 body_id;
+    u32 other_id;
+    u32 sequence;
+    Contact_Kind kind;
+    bool is_kept;
+    Hit hit;
+} Contact;
+
+ARRAY_LIST_DEFINE(contact_list, Contact)
+
+// Pairs touching in the last step, sorted by body, kind and other id, and
+// the events found by comparing them with the step before.
+typedef struct contact_cache {
+    Array_List *pair_list;
+    Array_List *next_pair_list;
+    Array_List *event_list;
+} Contact_Cache;
+
+typedef struct trigger_pair {
+    u32 trigger_id;
+    u32 body_id;
+} Trigger_Pair;
+
+ARRAY_LIST_DEFINE(trigger_pair_list, Trigger_Pair)
+
+typedef struct trigger_event {
+    Trigger_Pair pair;
+    Contact_State contact;
+} Trigger_Event;
+
+ARRAY_LIST_DEFINE(trigger_event_list, Trigger_Event)
+
+// Triggers live apart from the bodies and are only checked for overlaps,
+// once per step. pair_list holds the overlaps found last time, sorted by
+// trigger and body id. Callbacks are ids into callback_table, which is never
+// emptied, so snapshots can store them.
+typedef struct trigger_store {
+    Array_List *trigger_list;
+    Array_List *callback_id_list;
+    Array_List *callback_table;
+    Array_List *pair_list;
+    Array_List *next_pair_list;
+    Array_List *event_list;
+} Trigger_Store;
+
+// Where a body was during one substep of a parallel update. Every body has
+// room for max_substeps of them.
+typedef struct substep_record {
+    vec2 sweep_position;
+    vec2 stationary_position;
+    Hit static_hit;
+} Substep_Record;
+
+// Candidates of one body gathered once for all of its substeps, covering
+// everything between min and max.
+typedef struct step_candidates {
+    vec2 min;
+    vec2 max;
+    Array_List *id_list;
+    bool is_gathered;
+} Step_Candidates;
+
+// Buffers owned by a single thread during an update.
+typedef struct physics_scratch {
+    Broadphase_Query query;
+    Array_List *candidate_list;
+    Array_List *static_candidate_list;
+    Array_List *contact_list;
+    Array_List *overlap_list;
+    Sweep_Boxes sweep_boxes;
+    Step_Candidates step_statics;
+    Step_Candidates step_bodies;
+} Physics_Scratch;
+
+typedef void (*Physics_Job)(u32 thread_index, u32 thread_count, void *data);
+typedef struct physics_worker Physics_Worker;
+
+typedef struct physics_workers {
+    u32 thread_count;
+    bool is_quitting;
+    Physics_Job job;
+    void *data;
+    struct SDL_semaphore *done_sem;
+    Physics_Worker *worker_list;
+} Physics_Workers;
+
 typedef struct physics_state_internal {
     f32 gravity;
     f32 terminal_velocity;
-    Array_List *body_list;
+    f32 step_delta;
+    f32 accumulator;
+    u32 max_steps;
+    u32 max_substeps;
+    u32 substep_total;
+    u32 step_index;
+    // Counts resets, so physics_update can tell when a callback reset the
+    // physics in the middle of a step.
+    u32 reset_count;
+    // A reset asked for by a callback waits for the step to finish.
+    bool is_stepping;
+    bool is_reset_pending;
+    u32 lod_interval;
+    AABB lod_region;
+    // Items of body_map, indexed by slot like the lists below.
+    Slot_Map *body_map;
+    Paged_List *body_list;
+    Array_List *body_callback_id_list;
+    Array_List *callback_table;
+    Array_List *previous_position_list;
+    Array_List *still_step_list;
+    Array_List *lod_skip_list;
+    Array_List *step_weight_list;
     Array_List *static_body_list;
+    Body_Lanes lanes;
+    Broadphase_Grid grid;
+    Sweep_And_Prune sap;
+    bool is_sap_enabled;
+    Arena *level_arena;
+    bool is_level_in_arena;
+    Arena *frame_arena;
+    Bvh static_trees[STATIC_TREE_COUNT];
+    Contact_Cache contact_cache;
+    Trigger_Store triggers;
+    Physics_Workers workers;
+    Array_List *scratch_list;
+    Array_List *substep_list;
+    Array_List *stepped_list;
+    Array_List *event_handle_list;
+    Array_List *snapshot_scratch;
 } Physics_State_Internal;
+
+// Same results as SSE minps/maxps, which fminf/fmaxf don't guarantee for
+// signed zeros and NaN.
+static inline f32 ray_min(f32 a, f32 b) {
+    return a < b ? a : b;
+}
+
+static inline f32 ray_max(f32 a, f32 b) {
+    return a > b ? a : b;
+}
+
+void physics_list_resize(Array_List *list, size_t len);
+void physics_sort_ids(Array_List *id_list);
+void physics_unique_ids(Array_List *id_list);
+
+Hit ray_hit_at(vec2 pos, vec2 magnitude, AABB aabb, f32 time);
+
+void sweep_boxes_clear(Sweep_Boxes *boxes);
+void sweep_boxes_push(Sweep_Boxes *boxes, u32 id, AABB aabb, vec2 half_size);
+u32 ray_intersect_boxes(Sweep_Boxes *boxes, vec2 pos, vec2 magnitude);
+
+#ifdef PHYSICS_FIXED_POINT
+bool fixed_ray_entry(vec2 pos, vec2 magnitude, AABB aabb, Fixed *entry_time);
+#endif
+
+void body_lanes_begin(Body_Lanes *lanes, u32 count);
+void integrate_bodies(Body_Lanes *lanes, Paged_List *body_list, f32 gravity, f32 terminal_velocity, f32 scale, u32 max_substeps);
+void move_maskless_bodies(Body_Lanes *lanes, Paged_List *body_list);
+
+void broadphase_grid_init(Broadphase_Grid *grid, f32 cell_size);
+void broadphase_grid_begin(Broadphase_Grid *grid, u32 body_count);
+void broadphase_grid_insert(Broadphase_Grid *grid, u32 body_id, u8 collision_layer, f32 *min, f32 *max);
+void broadphase_grid_end(Broadphase_Grid *grid);
+void broadphase_grid_update(Broadphase_Grid *grid, u32 body_id, f32 *min, f32 *max);
+void broadphase_grid_query(Broadphase_Grid *grid, Broadphase_Query *query, u8 collision_mask, f32 *min, f32 *max, u32 body_count, Array_List *candidate_list);
+
+void contact_cache_init(Contact_Cache *cache);
+void contact_cache_reset(Contact_Cache *cache);
+void contact_cache_remove_body(Contact_Cache *cache, u32 body_id);
+void contact_cache_remap_statics(Contact_Cache *cache, const u32 *remap);
+void contact_cache_begin(Contact_Cache *cache);
+void contact_cache_add(Contact_Cache *cache, Array_List *contact_list);
+void contact_cache_end(Contact_Cache *cache, Paged_List *body_list, const u8 *is_integrated);
+
+void trigger_store_init(Trigger_Store *store);
+void trigger_store_reset(Trigger_Store *store);
+size_t trigger_store_create(Trigger_Store *store, AABB aabb, u8 collision_mask, On_Trigger on_trigger);
+On_Trigger trigger_store_callback(Trigger_Store *store, u32 trigger_id);
+void trigger_store_remove_body(Trigger_Store *store, u32 body_id);
+void trigger_store_update(Trigger_Store *store, Broadphase_Grid *grid, Broadphase_Query *query, Paged_List *body_list, Array_List *candidate_list);
+
+size_t static_bodies_coalesce(Array_List *static_body_list, u32 *remap, Arena *arena);
+
+void snapshot_write(Physics_State_Internal *state, Array_List *snapshot);
+bool snapshot_read(Physics_State_Internal *state, const u8 *snapshot);
+size_t snapshot_size(const u8 *snapshot);
+void snapshot_delta_write(Array_List *delta, const u8 *snapshot, const u8 *base);
+void snapshot_delta_apply(Array_List *snapshot, const u8 *delta, const u8 *base);
+
+void sap_init(Sweep_And_Prune *sap);
+void sap_clear(Sweep_And_Prune *sap);
+void sap_begin(Sweep_And_Prune *sap, u32 body_count);
+void sap_set(Sweep_And_Prune *sap, u32 body_id, f32 *min, f32 *max);
+void sap_end(Sweep_And_Prune *sap);
+u32 *sap_neighbors(Sweep_And_Prune *sap, u32 body_id, u32 *count);
+u32 sap_brute_force_pair_count(Sweep_And_Prune *sap);
+
+void bvh_init(Bvh *bvh, u32 layer);
+void bvh_build(Bvh *bvh, Array_List *static_body_list);
+void bvh_query(Bvh *bvh, f32 *min, f32 *max, Array_List *candidate_list);
+
+void physics_workers_start(Physics_Workers *workers, u32 thread_count);
+void physics_workers_stop(Physics_Workers *workers);
+void physics_workers_run(Physics_Workers *workers, Physics_Job job, void *data);
@@ -0,0 +1,33 @@
+#include <stdlib.h>
+
+#include "../util.h"
+#include "physics_internal.h"
+
+void physics_list_resize(Array_List *list, size_t len) {
+    array_list_grow(list, len);
+    list->len = len;
+}
+
+static int compare_id(const void *a, const void *b) {
+    u32 x = *(const u32*)a;
+    u32 y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
+
+void physics_sort_ids(Array_List *id_list) {
+    qsort(id_list->items, id_list->len, sizeof(u32), compare_id);
+}
+
+// Drops repeated ids from a sorted list.
+void physics_unique_ids(Array_List *id_list) {
+    u32 *ids = id_list->items;
+    size_t len = 0;
+
+    for (size_t i = 0; i < id_list->len; i++) {
+        if (len == 0 || ids[len - 1] != ids[i]) {
+            ids[len++] = ids[i];
+        }
+    }
+
+    id_list->len = len;
+}
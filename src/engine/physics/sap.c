@@ -0,0 +1,412 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include <linmath.h>
+
+#include "../util.h"
+#include "physics_internal.h"
+
+#define SAP_MAX_BIT 1u
+#define SAP_EMPTY_KEY UINT64_MAX
+#define SAP_REMOVED_KEY (UINT64_MAX - 1)
+// Must be a power of two.
+#define SAP_MIN_TABLE_SIZE 1024
+
+static u32 endpoint_body(Sap_Endpoint endpoint) {
+    return endpoint.id >> 1;
+}
+
+static bool endpoint_is_max(Sap_Endpoint endpoint) {
+    return (endpoint.id & SAP_MAX_BIT) != 0;
+}
+
+static f32 *bounds_get(Sweep_And_Prune *sap, u32 body_id) {
+    return ((vec4*)sap->bounds_list->items)[body_id];
+}
+
+static f32 endpoint_value(Sweep_And_Prune *sap, Sap_Endpoint endpoint, u8 axis) {
+    return bounds_get(sap, endpoint_body(endpoint))[axis + (endpoint_is_max(endpoint) ? 2 : 0)];
+}
+
+static bool bounds_overlap(Sweep_And_Prune *sap, u32 a, u32 b) {
+    f32 *bounds_a = bounds_get(sap, a);
+    f32 *bounds_b = bounds_get(sap, b);
+
+    return bounds_a[0] <= bounds_b[2] && bounds_b[0] <= bounds_a[2] &&
+           bounds_a[1] <= bounds_b[3] && bounds_b[1] <= bounds_a[3];
+}
+
+static u64 pair_key(u32 a, u32 b) {
+    return a < b ? (u64)a << 32 | b : (u64)b << 32 | a;
+}
+
+static u32 key_slot(u64 key, u32 table_size) {
+    return (u32)((key * 0x9E3779B97F4A7C15ull) >> 32) & (table_size - 1);
+}
+
+static void table_clear(Array_List *table, u32 table_size) {
+    physics_list_resize(table, table_size);
+    u64 *keys = table->items;
+
+    for (u32 i = 0; i < table_size; i++) {
+        keys[i] = SAP_EMPTY_KEY;
+    }
+}
+
+static void table_insert(Array_List *table, u64 key) {
+    u64 *keys = table->items;
+    u32 table_size = (u32)table->len;
+    u32 slot = key_slot(key, table_size);
+
+    while (keys[slot] != SAP_EMPTY_KEY) {
+        slot = (slot + 1) & (table_size - 1);
+    }
+
+    keys[slot] = key;
+}
+
+// Rehashes into a table at least four times the size of the pair count,
+// which also clears out removed slots.
+static void table_grow(Sweep_And_Prune *sap) {
+    u32 table_size = SAP_MIN_TABLE_SIZE;
+    while (table_size < sap->pair_count * 4) {
+        table_size *= 2;
+    }
+
+    Array_List *old_table = sap->pair_table;
+    sap->pair_table = sap->spare_table;
+    sap->spare_table = old_table;
+    table_clear(sap->pair_table, table_size);
+
+    u64 *old_keys = old_table->items;
+    for (size_t i = 0; i < old_table->len; i++) {
+        if (old_keys[i] < SAP_REMOVED_KEY) {
+            table_insert(sap->pair_table, old_keys[i]);
+        }
+    }
+
+    sap->removed_count = 0;
+}
+
+static void pair_add(Sweep_And_Prune *sap, u32 a, u32 b) {
+    u64 key = pair_key(a, b);
+    u64 *keys = sap->pair_table->items;
+    u32 table_size = (u32)sap->pair_table->len;
+    u32 slot = key_slot(key, table_size);
+
+    while (keys[slot] != SAP_EMPTY_KEY) {
+        if (keys[slot] == key) {
+            return;
+        }
+        slot = (slot + 1) & (table_size - 1);
+    }
+
+    keys[slot] = key;
+    sap->pair_count++;
+
+    if ((sap->pair_count + sap->removed_count) * 2 > table_size) {
+        table_grow(sap);
+    }
+}
+
+static void pair_remove(Sweep_And_Prune *sap, u32 a, u32 b) {
+    u64 key = pair_key(a, b);
+    u64 *keys = sap->pair_table->items;
+    u32 table_size = (u32)sap->pair_table->len;
+    u32 slot = key_slot(key, table_size);
+
+    while (keys[slot] != SAP_EMPTY_KEY) {
+        if (keys[slot] == key) {
+            keys[slot] = SAP_REMOVED_KEY;
+            sap->pair_count--;
+            sap->removed_count++;
+            return;
+        }
+        slot = (slot + 1) & (table_size - 1);
+    }
+}
+
+void sap_init(Sweep_And_Prune *sap) {
+    *sap = (Sweep_And_Prune){
+        .endpoint_lists = {
+            array_list_create(sizeof(Sap_Endpoint), 0),
+            array_list_create(sizeof(Sap_Endpoint), 0),
+        },
+        .bounds_list = array_list_create(sizeof(vec4), 0),
+        .pair_table = array_list_create(sizeof(u64), 0),
+        .spare_table = array_list_create(sizeof(u64), 0),
+        .neighbor_start_list = array_list_create(sizeof(u32), 0),
+        .neighbor_list = array_list_create(sizeof(u32), 0),
+        .active_list = array_list_create(sizeof(u32), 0),
+    };
+
+    sap_clear(sap);
+}
+
+void sap_clear(Sweep_And_Prune *sap) {
+    sap->endpoint_lists[0]->len = 0;
+    sap->endpoint_lists[1]->len = 0;
+    sap->bounds_list->len = 0;
+    sap->body_count = 0;
+    sap->pair_count = 0;
+    sap->removed_count = 0;
+    table_clear(sap->pair_table, SAP_MIN_TABLE_SIZE);
+    physics_list_resize(sap->neighbor_start_list, 1);
+    ((u32*)sap->neighbor_start_list->items)[0] = 0;
+    sap->neighbor_list->len = 0;
+}
+
+// Bodies that aren't set before sap_end get inverted bounds, which overlap
+// nothing.
+void sap_begin(Sweep_And_Prune *sap, u32 body_count) {
+    if (body_count < sap->body_count) {
+        sap_clear(sap);
+    }
+
+    physics_list_resize(sap->bounds_list, body_count);
+    vec4 *bounds = sap->bounds_list->items;
+    for (u32 i = 0; i < body_count; i++) {
+        bounds[i][0] = INFINITY;
+        bounds[i][1] = INFINITY;
+        bounds[i][2] = -INFINITY;
+        bounds[i][3] = -INFINITY;
+    }
+}
+
+void sap_set(Sweep_And_Prune *sap, u32 body_id, f32 *min, f32 *max) {
+    f32 *bounds = bounds_get(sap, body_id);
+    bounds[0] = min[0];
+    bounds[1] = min[1];
+    bounds[2] = max[0];
+    bounds[3] = max[1];
+}
+
+// Bounds that touch overlap, so on equal values mins go before maxes.
+static bool endpoint_is_before(Sap_Endpoint a, Sap_Endpoint b) {
+    if (a.value != b.value) {
+        return a.value < b.value;
+    }
+
+    return !endpoint_is_max(a) && endpoint_is_max(b);
+}
+
+// Insertion sort, starting from the order of the last step. Every time a
+// min endpoint passes a max endpoint the two bodies may have started to
+// overlap, and the other way around they stopped.
+static void axis_update(Sweep_And_Prune *sap, u8 axis) {
+    Sap_Endpoint *endpoints = sap->endpoint_lists[axis]->items;
+    size_t count = sap->endpoint_lists[axis]->len;
+
+    for (size_t i = 0; i < count; i++) {
+        endpoints[i].value = endpoint_value(sap, endpoints[i], axis);
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        Sap_Endpoint endpoint = endpoints[i];
+        size_t j = i;
+
+        while (j > 0 && endpoint_is_before(endpoint, endpoints[j - 1])) {
+            Sap_Endpoint other = endpoints[j - 1];
+            u32 body_id = endpoint_body(endpoint);
+            u32 other_id = endpoint_body(other);
+
+            if (body_id == other_id) {
+                // A body whose bounds were or became inverted.
+            } else if (!endpoint_is_max(endpoint) && endpoint_is_max(other)) {
+                if (bounds_overlap(sap, body_id, other_id)) {
+                    pair_add(sap, body_id, other_id);
+                }
+            } else if (endpoint_is_max(endpoint) && !endpoint_is_max(other)) {
+                pair_remove(sap, body_id, other_id);
+            }
+
+            endpoints[j] = other;
+            j--;
+        }
+
+        endpoints[j] = endpoint;
+    }
+}
+
+static i32 endpoint_compare(const void *a, const void *b) {
+    const Sap_Endpoint *endpoint_a = a;
+    const Sap_Endpoint *endpoint_b = b;
+
+    if (endpoint_is_before(*endpoint_a, *endpoint_b)) {
+        return -1;
+    }
+
+    if (endpoint_is_before(*endpoint_b, *endpoint_a)) {
+        return 1;
+    }
+
+    return (endpoint_a->id > endpoint_b->id) - (endpoint_a->id < endpoint_b->id);
+}
+
+// Sorts from scratch and finds every pair with one sweep along x, for the
+// first step and whenever many bodies were added at once.
+static void rebuild(Sweep_And_Prune *sap, u32 body_count) {
+    for (u8 axis = 0; axis < 2; axis++) {
+        physics_list_resize(sap->endpoint_lists[axis], body_count * 2);
+        Sap_Endpoint *endpoints = sap->endpoint_lists[axis]->items;
+
+        for (u32 i = 0; i < body_count * 2; i++) {
+            endpoints[i].id = i;
+            endpoints[i].value = endpoint_value(sap, endpoints[i], axis);
+        }
+
+        qsort(endpoints, body_count * 2, sizeof(Sap_Endpoint), endpoint_compare);
+    }
+
+    sap->pair_count = 0;
+    sap->removed_count = 0;
+    table_clear(sap->pair_table, (u32)sap->pair_table->len);
+
+    Sap_Endpoint *endpoints = sap->endpoint_lists[0]->items;
+    sap->active_list->len = 0;
+
+    for (u32 i = 0; i < body_count * 2; i++) {
+        u32 body_id = endpoint_body(endpoints[i]);
+        u32 *active = sap->active_list->items;
+
+        if (endpoint_is_max(endpoints[i])) {
+            for (size_t j = 0; j < sap->active_list->len; j++) {
+                if (active[j] == body_id) {
+                    active[j] = active[--sap->active_list->len];
+                    break;
+                }
+            }
+            continue;
+        }
+
+        f32 *bounds = bounds_get(sap, body_id);
+        if (bounds[0] > bounds[2]) {
+            continue;
+        }
+
+        for (size_t j = 0; j < sap->active_list->len; j++) {
+            if (bounds_overlap(sap, body_id, active[j])) {
+                pair_add(sap, body_id, active[j]);
+                active = sap->active_list->items;
+            }
+        }
+
+        u32_list_append(sap->active_list, body_id);
+    }
+}
+
+// Lists the bodies each body overlaps, in ascending order.
+static void build_neighbors(Sweep_And_Prune *sap) {
+    u32 body_count = sap->body_count;
+    physics_list_resize(sap->neighbor_start_list, body_count + 1);
+    physics_list_resize(sap->neighbor_list, sap->pair_count * 2);
+
+    u32 *starts = sap->neighbor_start_list->items;
+    u32 *neighbors = sap->neighbor_list->items;
+    u64 *keys = sap->pair_table->items;
+    size_t table_size = sap->pair_table->len;
+
+    for (u32 i = 0; i <= body_count; i++) {
+        starts[i] = 0;
+    }
+
+    for (size_t i = 0; i < table_size; i++) {
+        if (keys[i] < SAP_REMOVED_KEY) {
+            starts[keys[i] >> 32]++;
+            starts[keys[i] & 0xFFFFFFFF]++;
+        }
+    }
+
+    u32 total = 0;
+    for (u32 i = 0; i < body_count; i++) {
+        u32 count = starts[i];
+        starts[i] = total;
+        total += count;
+    }
+    starts[body_count] = total;
+
+    // Filling moves every start to the end of its range, they are shifted
+    // back after.
+    for (size_t i = 0; i < table_size; i++) {
+        if (keys[i] < SAP_REMOVED_KEY) {
+            u32 a = (u32)(keys[i] >> 32);
+            u32 b = (u32)(keys[i] & 0xFFFFFFFF);
+            neighbors[starts[a]++] = b;
+            neighbors[starts[b]++] = a;
+        }
+    }
+
+    for (u32 i = body_count; i > 0; i--) {
+        starts[i] = starts[i - 1];
+    }
+    starts[0] = 0;
+
+    for (u32 i = 0; i < body_count; i++) {
+        for (u32 j = starts[i] + 1; j < starts[i + 1]; j++) {
+            u32 id = neighbors[j];
+            u32 k = j;
+
+            while (k > starts[i] && neighbors[k - 1] > id) {
+                neighbors[k] = neighbors[k - 1];
+                k--;
+            }
+
+            neighbors[k] = id;
+        }
+    }
+}
+
+void sap_end(Sweep_And_Prune *sap) {
+    u32 body_count = (u32)sap->bounds_list->len;
+    u32 added_count = body_count - sap->body_count;
+
+    // New bodies start out past the end of both axes, one after the other so
+    // they don't overlap, and are sorted in from there. Unless so many came
+    // at once that sorting from scratch is faster.
+    if (sap->body_count == 0 || added_count > body_count / 8) {
+        rebuild(sap, body_count);
+    } else {
+        for (u8 axis = 0; axis < 2; axis++) {
+            for (u32 i = sap->body_count * 2; i < body_count * 2; i++) {
+                Sap_Endpoint endpoint = {.value = INFINITY, .id = i};
+                if (array_list_append(sap->endpoint_lists[axis], &endpoint) == (size_t)-1) {
+                    ERROR_EXIT("Could not append sweep and prune endpoint\n");
+                }
+            }
+
+            axis_update(sap, axis);
+        }
+    }
+
+    sap->body_count = body_count;
+    build_neighbors(sap);
+}
+
+// The bodies whose bounds overlap those of body_id.
+u32 *sap_neighbors(Sweep_And_Prune *sap, u32 body_id, u32 *count) {
+    u32 *starts = sap->neighbor_start_list->items;
+
+    if (body_id >= sap->body_count) {
+        *count = 0;
+        return NULL;
+    }
+
+    *count = starts[body_id + 1] - starts[body_id];
+    return (u32*)sap->neighbor_list->items + starts[body_id];
+}
+
+// Every pair found by comparing all bounds with each other, for checking the
+// incremental pair set against.
+u32 sap_brute_force_pair_count(Sweep_And_Prune *sap) {
+    u32 count = 0;
+
+    for (u32 i = 0; i < sap->body_count; i++) {
+        for (u32 j = i + 1; j < sap->body_count; j++) {
+            if (bounds_overlap(sap, i, j)) {
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
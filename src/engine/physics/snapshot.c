@@ -0,0 +1,252 @@
+#include <string.h>
+
+#include "../util.h"
+#include "../physics.h"
+#include "physics_internal.h"
+
+// A snapshot is a header followed by a copy of each list below, found by
+// offset rather than by pointer, so the blob can be copied, saved or sent
+// anywhere and read back. Callbacks are stored as the ids of the callback
+// tables, which are never emptied. Everything else in the state is either
+// configuration or rebuilt every step.
+#define SNAPSHOT_MAGIC 0x50534e31
+#define SNAPSHOT_DELTA_MAGIC 0x50534431
+#define SNAPSHOT_ALIGN 8
+// Deltas store the chunks that differ from the base. Snapshots are padded to
+// a whole number of them.
+#define SNAPSHOT_CHUNK_SIZE 32
+
+typedef enum snapshot_section {
+    SNAPSHOT_BODIES,
+    SNAPSHOT_BODY_GENERATIONS,
+    SNAPSHOT_BODY_FREE_SLOTS,
+    SNAPSHOT_BODY_LIVE_SLOTS,
+    SNAPSHOT_BODY_LIVE_INDICES,
+    SNAPSHOT_BODY_CALLBACK_IDS,
+    SNAPSHOT_PREVIOUS_POSITIONS,
+    SNAPSHOT_STILL_STEPS,
+    SNAPSHOT_LOD_SKIPS,
+    SNAPSHOT_STATIC_BODIES,
+    SNAPSHOT_TRIGGERS,
+    SNAPSHOT_TRIGGER_CALLBACK_IDS,
+    SNAPSHOT_CONTACT_PAIRS,
+    SNAPSHOT_TRIGGER_PAIRS,
+    SNAPSHOT_SECTION_COUNT,
+} Snapshot_Section;
+
+typedef struct snapshot_range {
+    u32 offset;
+    u32 count;
+    u32 item_size;
+} Snapshot_Range;
+
+typedef struct snapshot_header {
+    u32 magic;
+    u32 size;
+    f32 accumulator;
+    u32 step_index;
+    Snapshot_Range ranges[SNAPSHOT_SECTION_COUNT];
+} Snapshot_Header;
+
+typedef struct snapshot_delta_header {
+    u32 magic;
+    u32 size;
+    u32 base_size;
+    u32 chunk_count;
+} Snapshot_Delta_Header;
+
+// The bodies are in a Paged_List, everything else in an Array_List.
+typedef struct snapshot_list {
+    Array_List *list;
+    Paged_List *paged_list;
+} Snapshot_List;
+
+static void section_lists(Physics_State_Internal *state, Snapshot_List sections[SNAPSHOT_SECTION_COUNT]) {
+    Array_List *lists[SNAPSHOT_SECTION_COUNT] = {0};
+    lists[SNAPSHOT_BODY_GENERATIONS] = state->body_map->generation_list;
+    lists[SNAPSHOT_BODY_FREE_SLOTS] = state->body_map->free_list;
+    lists[SNAPSHOT_BODY_LIVE_SLOTS] = state->body_map->live_list;
+    lists[SNAPSHOT_BODY_LIVE_INDICES] = state->body_map->live_index_list;
+    lists[SNAPSHOT_BODY_CALLBACK_IDS] = state->body_callback_id_list;
+    lists[SNAPSHOT_PREVIOUS_POSITIONS] = state->previous_position_list;
+    lists[SNAPSHOT_STILL_STEPS] = state->still_step_list;
+    lists[SNAPSHOT_LOD_SKIPS] = state->lod_skip_list;
+    lists[SNAPSHOT_STATIC_BODIES] = state->static_body_list;
+    lists[SNAPSHOT_TRIGGERS] = state->triggers.trigger_list;
+    lists[SNAPSHOT_TRIGGER_CALLBACK_IDS] = state->triggers.callback_id_list;
+    lists[SNAPSHOT_CONTACT_PAIRS] = state->contact_cache.pair_list;
+    lists[SNAPSHOT_TRIGGER_PAIRS] = state->triggers.pair_list;
+
+    for (u32 i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+        sections[i] = (Snapshot_List){.list = lists[i]};
+    }
+    sections[SNAPSHOT_BODIES].paged_list = state->body_list;
+}
+
+static size_t section_len(Snapshot_List section) {
+    return section.list ? section.list->len : section.paged_list->len;
+}
+
+static size_t section_item_size(Snapshot_List section) {
+    return section.list ? section.list->item_size : section.paged_list->item_size;
+}
+
+static void section_save(Snapshot_List section, u8 *destination) {
+    if (section.list) {
+        memcpy(destination, section.list->items, section.list->len * section.list->item_size);
+    } else {
+        paged_list_copy_out(section.paged_list, destination);
+    }
+}
+
+static void section_load(Snapshot_List section, const u8 *source, size_t count) {
+    if (section.list) {
+        physics_list_resize(section.list, count);
+        memcpy(section.list->items, source, count * section.list->item_size);
+    } else {
+        paged_list_resize(section.paged_list, count);
+        paged_list_copy_in(section.paged_list, source);
+    }
+}
+
+static size_t align_up(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static const Snapshot_Header *header_get(const u8 *snapshot) {
+    const Snapshot_Header *header = (const Snapshot_Header*)snapshot;
+    if (header->magic != SNAPSHOT_MAGIC) {
+        ERROR_EXIT("Invalid physics snapshot\n");
+    }
+
+    return header;
+}
+
+// The list's memory is reused, so saving every frame doesn't allocate once
+// it has grown to fit.
+void snapshot_write(Physics_State_Internal *state, Array_List *snapshot) {
+    Snapshot_List sections[SNAPSHOT_SECTION_COUNT];
+    section_lists(state, sections);
+
+    Snapshot_Header header = {
+        .magic = SNAPSHOT_MAGIC,
+        .accumulator = state->accumulator,
+        .step_index = state->step_index,
+    };
+    size_t size = align_up(sizeof(Snapshot_Header), SNAPSHOT_ALIGN);
+
+    for (u32 i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+        header.ranges[i] = (Snapshot_Range){
+            .offset = (u32)size,
+            .count = (u32)section_len(sections[i]),
+            .item_size = (u32)section_item_size(sections[i]),
+        };
+        size = align_up(size + section_len(sections[i]) * section_item_size(sections[i]), SNAPSHOT_ALIGN);
+    }
+
+    size = align_up(size, SNAPSHOT_CHUNK_SIZE);
+    header.size = (u32)size;
+
+    physics_list_resize(snapshot, size);
+    u8 *data = snapshot->items;
+    memset(data, 0, size);
+    memcpy(data, &header, sizeof(header));
+
+    for (u32 i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+        section_save(sections[i], data + header.ranges[i].offset);
+    }
+}
+
+// Returns whether the static bodies changed.
+bool snapshot_read(Physics_State_Internal *state, const u8 *snapshot) {
+    const Snapshot_Header *header = header_get(snapshot);
+    Snapshot_List sections[SNAPSHOT_SECTION_COUNT];
+    section_lists(state, sections);
+
+    Snapshot_Range statics = header->ranges[SNAPSHOT_STATIC_BODIES];
+    bool is_static_changed = statics.count != state->static_body_list->len ||
+        memcmp(snapshot + statics.offset, state->static_body_list->items, statics.count * statics.item_size) != 0;
+
+    for (u32 i = 0; i < SNAPSHOT_SECTION_COUNT; i++) {
+        Snapshot_Range range = header->ranges[i];
+        if (range.item_size != section_item_size(sections[i])) {
+            ERROR_EXIT("Physics snapshot was saved by a different build\n");
+        }
+
+        section_load(sections[i], snapshot + range.offset, range.count);
+    }
+
+    state->accumulator = header->accumulator;
+    state->step_index = header->step_index;
+
+    return is_static_changed;
+}
+
+size_t snapshot_size(const u8 *snapshot) {
+    u32 magic;
+    memcpy(&magic, snapshot, sizeof(magic));
+
+    if (magic == SNAPSHOT_DELTA_MAGIC) {
+        const Snapshot_Delta_Header *header = (const Snapshot_Delta_Header*)snapshot;
+        return sizeof(Snapshot_Delta_Header) + header->chunk_count * (sizeof(u32) + SNAPSHOT_CHUNK_SIZE);
+    }
+
+    return header_get(snapshot)->size;
+}
+
+// A delta holds the indices of the chunks of snapshot that differ from base,
+// followed by those chunks. Chunks past the end of base are always stored.
+void snapshot_delta_write(Array_List *delta, const u8 *snapshot, const u8 *base) {
+    u32 size = header_get(snapshot)->size;
+    u32 base_size = header_get(base)->size;
+    u32 chunk_total = size / SNAPSHOT_CHUNK_SIZE;
+    u32 chunk_count = 0;
+
+    // Sized for the worst case, then trimmed.
+    physics_list_resize(delta, sizeof(Snapshot_Delta_Header) + chunk_total * (sizeof(u32) + SNAPSHOT_CHUNK_SIZE));
+    u32 *chunk_ids = (u32*)((u8*)delta->items + sizeof(Snapshot_Delta_Header));
+
+    for (u32 i = 0; i < chunk_total; i++) {
+        u32 offset = i * SNAPSHOT_CHUNK_SIZE;
+
+        if (offset >= base_size || memcmp(snapshot + offset, base + offset, SNAPSHOT_CHUNK_SIZE) != 0) {
+            chunk_ids[chunk_count++] = i;
+        }
+    }
+
+    u8 *chunks = (u8*)(chunk_ids + chunk_count);
+    for (u32 i = 0; i < chunk_count; i++) {
+        memcpy(chunks + i * SNAPSHOT_CHUNK_SIZE, snapshot + chunk_ids[i] * SNAPSHOT_CHUNK_SIZE, SNAPSHOT_CHUNK_SIZE);
+    }
+
+    Snapshot_Delta_Header header = {
+        .magic = SNAPSHOT_DELTA_MAGIC,
+        .size = size,
+        .base_size = base_size,
+        .chunk_count = chunk_count,
+    };
+    memcpy(delta->items, &header, sizeof(header));
+
+    delta->len = snapshot_size(delta->items);
+}
+
+// Rebuilds the full snapshot a delta was made from into snapshot.
+void snapshot_delta_apply(Array_List *snapshot, const u8 *delta, const u8 *base) {
+    const Snapshot_Delta_Header *header = (const Snapshot_Delta_Header*)delta;
+    u32 base_size = header_get(base)->size;
+
+    if (header->magic != SNAPSHOT_DELTA_MAGIC || header->base_size != base_size) {
+        ERROR_EXIT("Physics snapshot delta doesn't match its base\n");
+    }
+
+    physics_list_resize(snapshot, header->size);
+    u8 *data = snapshot->items;
+    memcpy(data, base, header->size < base_size ? header->size : base_size);
+
+    const u32 *chunk_ids = (const u32*)(delta + sizeof(Snapshot_Delta_Header));
+    const u8 *chunks = (const u8*)(chunk_ids + header->chunk_count);
+
+    for (u32 i = 0; i < header->chunk_count; i++) {
+        memcpy(data + chunk_ids[i] * SNAPSHOT_CHUNK_SIZE, chunks + i * SNAPSHOT_CHUNK_SIZE, SNAPSHOT_CHUNK_SIZE);
+    }
+}
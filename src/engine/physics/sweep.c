@@ -0,0 +1,172 @@
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PHYSICS_SSE
+#endif
+
+#include "../util.h"
+#include "physics_internal.h"
+
+// Boxes are padded to a whole number of vectors.
+#define BOX_WIDTH 4
+
+static void *box_lane_resize(void *lane, size_t size) {
+    void *result = realloc(lane, size);
+    if (!result) {
+        ERROR_EXIT("Could not allocate memory for sweep boxes\n");
+    }
+
+    return result;
+}
+
+static void sweep_boxes_reserve(Sweep_Boxes *boxes, u32 count) {
+    if (count <= boxes->capacity) {
+        return;
+    }
+
+    u32 capacity = boxes->capacity > 0 ? boxes->capacity : BOX_WIDTH;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    boxes->min_x = box_lane_resize(boxes->min_x, capacity * sizeof(f32));
+    boxes->min_y = box_lane_resize(boxes->min_y, capacity * sizeof(f32));
+    boxes->max_x = box_lane_resize(boxes->max_x, capacity * sizeof(f32));
+    boxes->max_y = box_lane_resize(boxes->max_y, capacity * sizeof(f32));
+    boxes->entry_time = box_lane_resize(boxes->entry_time, capacity * sizeof(f32));
+    boxes->aabb = box_lane_resize(boxes->aabb, capacity * sizeof(AABB));
+    boxes->id = box_lane_resize(boxes->id, capacity * sizeof(u32));
+    boxes->hit_index = box_lane_resize(boxes->hit_index, capacity * sizeof(u32));
+    boxes->capacity = capacity;
+}
+
+void sweep_boxes_clear(Sweep_Boxes *boxes) {
+    boxes->count = 0;
+}
+
+// Adds aabb grown by half_size, computed the same way as the scalar sweep so
+// the packed bounds are bitwise identical to what ray_intersect_aabb sees.
+void sweep_boxes_push(Sweep_Boxes *boxes, u32 id, AABB aabb, vec2 half_size) {
+    sweep_boxes_reserve(boxes, boxes->count + BOX_WIDTH);
+
+    u32 i = boxes->count++;
+    AABB *sum_aabb = &boxes->aabb[i];
+    *sum_aabb = aabb;
+    vec2_add(sum_aabb->half_size, sum_aabb->half_size, half_size);
+
+    vec2 min, max;
+    aabb_min_max(min, max, *sum_aabb);
+    boxes->min_x[i] = min[0];
+    boxes->min_y[i] = min[1];
+    boxes->max_x[i] = max[0];
+    boxes->max_y[i] = max[1];
+    boxes->id[i] = id;
+}
+
+#if defined(PHYSICS_FIXED_POINT)
+// Same test as the fixed point ray_intersect_aabb, one box at a time.
+u32 ray_intersect_boxes(Sweep_Boxes *boxes, vec2 pos, vec2 magnitude) {
+    u32 hit_count = 0;
+
+    for (u32 i = 0; i < boxes->count; i++) {
+        Fixed entry_time;
+
+        if (fixed_ray_entry(pos, magnitude, boxes->aabb[i], &entry_time)) {
+            boxes->entry_time[i] = fixed_to_f32(entry_time);
+            boxes->hit_index[hit_count++] = i;
+        }
+    }
+
+    return hit_count;
+}
+#elif defined(PHYSICS_SSE)
+u32 ray_intersect_boxes(Sweep_Boxes *boxes, vec2 pos, vec2 magnitude) {
+    u32 hit_count = 0;
+
+    // Pad the last vector with boxes whose results are masked off below.
+    for (u32 i = boxes->count; i % BOX_WIDTH != 0; i++) {
+        boxes->min_x[i] = boxes->min_y[i] = boxes->max_x[i] = boxes->max_y[i] = 0;
+    }
+
+    f32 *lane_min[2] = {boxes->min_x, boxes->min_y};
+    f32 *lane_max[2] = {boxes->max_x, boxes->max_y};
+    __m128 pos_v[2] = {_mm_set1_ps(pos[0]), _mm_set1_ps(pos[1])};
+    __m128 magnitude_v[2] = {_mm_set1_ps(magnitude[0]), _mm_set1_ps(magnitude[1])};
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1);
+
+    for (u32 i = 0; i < boxes->count; i += BOX_WIDTH) {
+        __m128 last_entry = _mm_set1_ps(-INFINITY);
+        __m128 first_exit = _mm_set1_ps(INFINITY);
+        __m128 is_inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (u8 axis = 0; axis < 2; axis++) {
+            __m128 min = _mm_loadu_ps(lane_min[axis] + i);
+            __m128 max = _mm_loadu_ps(lane_max[axis] + i);
+
+            if (magnitude[axis] != 0) {
+                // Divide rather than multiply by a reciprocal, which rounds
+                // differently and would not match the scalar path.
+                __m128 t1 = _mm_div_ps(_mm_sub_ps(min, pos_v[axis]), magnitude_v[axis]);
+                __m128 t2 = _mm_div_ps(_mm_sub_ps(max, pos_v[axis]), magnitude_v[axis]);
+
+                last_entry = _mm_max_ps(last_entry, _mm_min_ps(t1, t2));
+                first_exit = _mm_min_ps(first_exit, _mm_max_ps(t1, t2));
+            } else {
+                is_inside = _mm_and_ps(is_inside, _mm_and_ps(_mm_cmpnle_ps(pos_v[axis], min), _mm_cmpnge_ps(pos_v[axis], max)));
+            }
+        }
+
+        __m128 is_hit = _mm_and_ps(is_inside, _mm_cmpgt_ps(first_exit, last_entry));
+        is_hit = _mm_and_ps(is_hit, _mm_cmpgt_ps(first_exit, zero));
+        is_hit = _mm_and_ps(is_hit, _mm_cmplt_ps(last_entry, one));
+
+        u32 mask = (u32)_mm_movemask_ps(is_hit);
+        if (mask == 0) {
+            continue;
+        }
+
+        _mm_storeu_ps(boxes->entry_time + i, last_entry);
+
+        for (u32 lane = 0; lane < BOX_WIDTH && i + lane < boxes->count; lane++) {
+            if (mask & (1 << lane)) {
+                boxes->hit_index[hit_count++] = i + lane;
+            }
+        }
+    }
+
+    return hit_count;
+}
+#else
+u32 ray_intersect_boxes(Sweep_Boxes *boxes, vec2 pos, vec2 magnitude) {
+    u32 hit_count = 0;
+
+    for (u32 i = 0; i < boxes->count; i++) {
+        f32 min[2] = {boxes->min_x[i], boxes->min_y[i]};
+        f32 max[2] = {boxes->max_x[i], boxes->max_y[i]};
+        f32 last_entry = -INFINITY;
+        f32 first_exit = INFINITY;
+        bool is_inside = true;
+
+        for (u8 axis = 0; axis < 2; axis++) {
+            if (magnitude[axis] != 0) {
+                f32 t1 = (min[axis] - pos[axis]) / magnitude[axis];
+                f32 t2 = (max[axis] - pos[axis]) / magnitude[axis];
+
+                last_entry = ray_max(last_entry, ray_min(t1, t2));
+                first_exit = ray_min(first_exit, ray_max(t1, t2));
+            } else if (pos[axis] <= min[axis] || pos[axis] >= max[axis]) {
+                is_inside = false;
+            }
+        }
+
+        if (is_inside && first_exit > last_entry && first_exit > 0 && last_entry < 1) {
+            boxes->entry_time[i] = last_entry;
+            boxes->hit_index[hit_count++] = i;
+        }
+    }
+
+    return hit_count;
+}
+#endif
@@ -0,0 +1,154 @@
+#include <linmath.h>
+
+#include "../util.h"
+#include "../physics.h"
+#include "physics_internal.h"
+
+static i32 trigger_pair_compare(const Trigger_Pair *a, const Trigger_Pair *b) {
+    if (a->trigger_id != b->trigger_id) {
+        return a->trigger_id < b->trigger_id ? -1 : 1;
+    }
+
+    if (a->body_id != b->body_id) {
+        return a->body_id < b->body_id ? -1 : 1;
+    }
+
+    return 0;
+}
+
+void trigger_store_init(Trigger_Store *store) {
+    *store = (Trigger_Store){
+        .trigger_list = array_list_create(sizeof(Trigger), 0),
+        .callback_id_list = array_list_create(sizeof(u32), 0),
+        .callback_table = array_list_create(sizeof(On_Trigger), 0),
+        .pair_list = array_list_create(sizeof(Trigger_Pair), 0),
+        .next_pair_list = array_list_create(sizeof(Trigger_Pair), 0),
+        .event_list = array_list_create(sizeof(Trigger_Event), 0),
+    };
+}
+
+void trigger_store_reset(Trigger_Store *store) {
+    store->trigger_list->len = 0;
+    store->callback_id_list->len = 0;
+    store->pair_list->len = 0;
+    store->next_pair_list->len = 0;
+    store->event_list->len = 0;
+}
+
+static u32 callback_id(Trigger_Store *store, On_Trigger on_trigger) {
+    On_Trigger *callbacks = store->callback_table->items;
+
+    for (u32 i = 0; i < store->callback_table->len; i++) {
+        if (callbacks[i] == on_trigger) {
+            return i;
+        }
+    }
+
+    if (array_list_append(store->callback_table, &on_trigger) == (size_t)-1) {
+        ERROR_EXIT("Could not append trigger callback to table\n");
+    }
+
+    return (u32)store->callback_table->len - 1;
+}
+
+On_Trigger trigger_store_callback(Trigger_Store *store, u32 trigger_id) {
+    u32 *callback_id = u32_list_get(store->callback_id_list, trigger_id);
+    return ((On_Trigger*)store->callback_table->items)[*callback_id];
+}
+
+size_t trigger_store_create(Trigger_Store *store, AABB aabb, u8 collision_mask, On_Trigger on_trigger) {
+    Trigger trigger = {
+        .aabb = aabb,
+        .collision_mask = collision_mask,
+        .is_active = true,
+    };
+
+    if (array_list_append(store->trigger_list, &trigger) == (size_t)-1) {
+        ERROR_EXIT("Could not append trigger to list\n");
+    }
+
+    u32 id = callback_id(store, on_trigger);
+    if (array_list_append(store->callback_id_list, &id) == (size_t)-1) {
+        ERROR_EXIT("Could not append trigger callback to list\n");
+    }
+
+    return store->trigger_list->len - 1;
+}
+
+// Drops every pair the body is part of, so a reused body slot enters
+// triggers afresh.
+void trigger_store_remove_body(Trigger_Store *store, u32 body_id) {
+    Trigger_Pair *pairs = store->pair_list->items;
+    size_t count = 0;
+
+    for (size_t i = 0; i < store->pair_list->len; i++) {
+        if (pairs[i].body_id != body_id) {
+            pairs[count++] = pairs[i];
+        }
+    }
+
+    store->pair_list->len = count;
+}
+
+static void event_append(Trigger_Store *store, Trigger_Pair pair, Contact_State contact) {
+    trigger_event_list_append(store->event_list, (Trigger_Event){.pair = pair, .contact = contact});
+}
+
+// Finds the bodies overlapping each trigger through the grid and appends an
+// enter or exit event for every pair that started or stopped overlapping
+// since the last update.
+void trigger_store_update(Trigger_Store *store, Broadphase_Grid *grid, Broadphase_Query *query, Paged_List *body_list, Array_List *candidate_list) {
+    Trigger *triggers = store->trigger_list->items;
+
+    store->next_pair_list->len = 0;
+    store->event_list->len = 0;
+
+    // Triggers and candidates are visited in ascending order, so the pairs
+    // come out sorted.
+    for (size_t i = 0; i < store->trigger_list->len; i++) {
+        Trigger *trigger = &triggers[i];
+
+        if (!trigger->is_active || trigger->collision_mask == 0) {
+            continue;
+        }
+
+        vec2 min, max;
+        aabb_min_max(min, max, trigger->aabb);
+        broadphase_grid_query(grid, query, trigger->collision_mask, min, max, body_list->len, candidate_list);
+
+        u32 *candidates = candidate_list->items;
+        for (size_t j = 0; j < candidate_list->len; j++) {
+            Body *body = paged_list_get(body_list, candidates[j]);
+
+            if (!body->is_active || (trigger->collision_mask & body->collision_layer) == 0 || !physics_aabb_intersect_aabb(trigger->aabb, body->aabb)) {
+                continue;
+            }
+
+            trigger_pair_list_append(store->next_pair_list, (Trigger_Pair){.trigger_id = (u32)i, .body_id = candidates[j]});
+        }
+    }
+
+    Trigger_Pair *pairs = store->pair_list->items;
+    Trigger_Pair *next_pairs = store->next_pair_list->items;
+    size_t pair_count = store->pair_list->len;
+    size_t next_count = store->next_pair_list->len;
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < pair_count || j < next_count) {
+        i32 order = i == pair_count ? 1 : j == next_count ? -1 : trigger_pair_compare(&pairs[i], &next_pairs[j]);
+
+        if (order < 0) {
+            event_append(store, pairs[i++], CONTACT_EXIT);
+        } else if (order > 0) {
+            event_append(store, next_pairs[j++], CONTACT_ENTER);
+        } else {
+            i++;
+            j++;
+        }
+    }
+
+    Array_List *pair_list = store->pair_list;
+    store->pair_list = store->next_pair_list;
+    store->next_pair_list = pair_list;
+}
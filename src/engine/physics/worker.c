@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+#include "../util.h"
+#include "physics_internal.h"
+
+struct physics_worker {
+    Physics_Workers *workers;
+    SDL_Thread *thread;
+    SDL_sem *start_sem;
+    u32 index;
+};
+
+static int worker_run(void *data) {
+    Physics_Worker *worker = data;
+    Physics_Workers *workers = worker->workers;
+
+    for (;;) {
+        SDL_SemWait(worker->start_sem);
+
+        if (workers->is_quitting) {
+            return 0;
+        }
+
+        workers->job(worker->index, workers->thread_count, workers->data);
+        SDL_SemPost(workers->done_sem);
+    }
+}
+
+// The calling thread takes part in every job as thread 0, so only
+// thread_count - 1 threads are started.
+void physics_workers_start(Physics_Workers *workers, u32 thread_count) {
+    *workers = (Physics_Workers){.thread_count = thread_count > 0 ? thread_count : 1};
+
+    if (thread_count <= 1) {
+        return;
+    }
+
+    workers->done_sem = SDL_CreateSemaphore(0);
+    workers->worker_list = calloc(thread_count, sizeof(Physics_Worker));
+    if (!workers->done_sem || !workers->worker_list) {
+        ERROR_EXIT("Could not create physics workers\n");
+    }
+
+    // Each worker waits on its own semaphore, so a fast one can't take the
+    // start of another.
+    for (u32 i = 1; i < thread_count; i++) {
+        Physics_Worker *worker = &workers->worker_list[i];
+        worker->workers = workers;
+        worker->index = i;
+        worker->start_sem = SDL_CreateSemaphore(0);
+        if (!worker->start_sem) {
+            ERROR_EXIT("Could not create physics worker semaphore: %s\n", SDL_GetError());
+        }
+
+        worker->thread = SDL_CreateThread(worker_run, "physics", worker);
+        if (!worker->thread) {
+            ERROR_EXIT("Could not create physics thread: %s\n", SDL_GetError());
+        }
+    }
+}
+
+void physics_workers_stop(Physics_Workers *workers) {
+    if (workers->thread_count <= 1) {
+        return;
+    }
+
+    workers->is_quitting = true;
+    for (u32 i = 1; i < workers->thread_count; i++) {
+        SDL_SemPost(workers->worker_list[i].start_sem);
+    }
+
+    for (u32 i = 1; i < workers->thread_count; i++) {
+        SDL_WaitThread(workers->worker_list[i].thread, NULL);
+        SDL_DestroySemaphore(workers->worker_list[i].start_sem);
+    }
+
+    SDL_DestroySemaphore(workers->done_sem);
+    free(workers->worker_list);
+
+    *workers = (Physics_Workers){.thread_count = 1};
+}
+
+// Runs job on every thread and returns once all of them have finished.
+void physics_workers_run(Physics_Workers *workers, Physics_Job job, void *data) {
+    workers->job = job;
+    workers->data = data;
+
+    for (u32 i = 1; i < workers->thread_count; i++) {
+        SDL_SemPost(workers->worker_list[i].start_sem);
+    }
+
+    job(0, workers->thread_count, data);
+
+    for (u32 i = 1; i < workers->thread_count; i++) {
+        SDL_SemWait(workers->done_sem);
+    }
+}
@@ -8,6 +8,8 @@
 #include "../util.h"
 #include "render_internal.h"
 
+ARRAY_LIST_DEFINE(batch_vertex_list, Batch_Vertex)
+
 static f32 window_width = 1920;
 static f32 window_height = 1080;
 static f32 render_width = 640;
@@ -25,7 +27,10 @@ static u32 vao_batch;
 static u32 vbo_batch;
 static u32 ebo_batch;
 static u32 shader_batch;
+// Lives in the frame arena, made again every frame with room for as many
+// vertices as the last one had.
 static Array_List *list_batch;
+static size_t batch_vertex_count;
 
 SDL_Window *render_init(void) {
     SDL_Window *window = render_init_window(window_width, window_height);
@@ -39,8 +44,6 @@ SDL_Window *render_init(void) {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    list_batch = array_list_create(sizeof(Batch_Vertex), 8);
-
     // for some reason they load upside down
     stbi_set_flip_vertically_on_load(1);
 
@@ -77,7 +80,7 @@ void render_begin(void) {
     glClearColor(0.08, 0.1, 0.1, 0.1);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    list_batch->len = 0;
+    list_batch = array_list_create_in(&global.frame_arena, sizeof(Batch_Vertex), batch_vertex_count > 8 ? batch_vertex_count : 8);
 }
 
 static void render_batch(Batch_Vertex *vertices, size_t count, u32 texture_ids[8]) {
@@ -105,37 +108,41 @@ static void append_quad(vec2 position, vec2 size, vec4 texture_coordinates, vec4
         memcpy(uvs, texture_coordinates, sizeof(vec4));
     }
 
-    array_list_append(list_batch, &(Batch_Vertex){
+    // All four vertices go straight into the list, which grows at most once.
+    Batch_Vertex *vertices = batch_vertex_list_emplace_n(list_batch, 4);
+
+    vertices[0] = (Batch_Vertex){
         .position = {position[0], position[1]},
         .uvs = {uvs[0], uvs[1]},
         .color = {color[0], color[1], color[2], color[3]},
         .texture_slot = texture_slot,
-    });
+    };
 
-    array_list_append(list_batch, &(Batch_Vertex){
+    vertices[1] = (Batch_Vertex){
         .position = {position[0] + size[0], position[1]},
         .uvs = {uvs[2], uvs[1]},
         .color = {color[0], color[1], color[2], color[3]},
         .texture_slot = texture_slot,
-    });
+    };
 
-    array_list_append(list_batch, &(Batch_Vertex){
+    vertices[2] = (Batch_Vertex){
         .position = {position[0] + size[0], position[1] + size[1]},
         .uvs = {uvs[2], uvs[3]},
         .color = {color[0], color[1], color[2], color[3]},
         .texture_slot = texture_slot,
-    });
+    };
 
-    array_list_append(list_batch, &(Batch_Vertex){
+    vertices[3] = (Batch_Vertex){
         .position = {position[0], position[1] + size[1]},
         .uvs = {uvs[0], uvs[3]},
         .color = {color[0], color[1], color[2], color[3]},
         .texture_slot = texture_slot,
-    });
+    };
 }
 
 void render_end(SDL_Window *window, u32 batch_texture_ids[8]) {
     render_batch(list_batch->items, list_batch->len, batch_texture_ids);
+    batch_vertex_count = list_batch->len;
     SDL_GL_SwapWindow(window);
 }
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types.h"
+#include "array_list.h"
+#include "paged_list.h"
+
+// Slot in the low 32 bits, generation in the high ones. The generation of a
+// slot changes every time it is filled or emptied, so a handle to an item
+// that was removed never finds whatever took its slot.
+typedef u64 Handle;
+
+#define HANDLE_NONE ((Handle)-1)
+
+// Items never move while they are alive, not even when the map grows, so
+// they can be indexed by slot alongside other lists and pointers to them
+// stay valid until they are removed. Removed slots are reused from a free
+// list, and the live slots are also kept packed for iterating over.
+typedef struct slot_map {
+    Paged_List *item_list;
+    Array_List *generation_list;
+    Array_List *free_list;
+    Array_List *live_list;
+    Array_List *live_index_list;
+} Slot_Map;
+
+Slot_Map *slot_map_create(size_t item_size, size_t initial_capacity);
+Handle slot_map_insert(Slot_Map *map, void *item);
+bool slot_map_remove(Slot_Map *map, Handle handle);
+void *slot_map_get(Slot_Map *map, Handle handle);
+Handle slot_map_handle(Slot_Map *map, u32 slot);
+void slot_map_reserve(Slot_Map *map, size_t count);
+size_t slot_map_count(Slot_Map *map);
+void *slot_map_at(Slot_Map *map, size_t index);
+void slot_map_clear(Slot_Map *map);
+
+static inline u32 handle_slot(Handle handle) {
+    return (u32)handle;
+}
+
+ARRAY_LIST_DEFINE(handle_list, Handle)
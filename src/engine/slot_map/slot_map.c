@@ -0,0 +1,134 @@
+#include <string.h>
+
+#include "../util.h"
+#include "../slot_map.h"
+
+static Handle handle_make(u32 slot, u32 generation) {
+    return (u64)generation << 32 | slot;
+}
+
+static u32 handle_generation(Handle handle) {
+    return (u32)(handle >> 32);
+}
+
+Slot_Map *slot_map_create(size_t item_size, size_t initial_capacity) {
+    Slot_Map *map = malloc(sizeof(Slot_Map));
+
+    if (!map)
+        ERROR_RETURN(NULL, "Could not allocate memory for Slot_Map\n");
+
+    *map = (Slot_Map){
+        .item_list = paged_list_create(item_size),
+        .generation_list = array_list_create(sizeof(u32), initial_capacity),
+        .free_list = array_list_create(sizeof(u32), 0),
+        .live_list = array_list_create(sizeof(u32), initial_capacity),
+        .live_index_list = array_list_create(sizeof(u32), initial_capacity),
+    };
+
+    return map;
+}
+
+// Copies item into a free slot.
+Handle slot_map_insert(Slot_Map *map, void *item) {
+    u32 slot;
+
+    if (map->free_list->len > 0) {
+        slot = ((u32*)map->free_list->items)[--map->free_list->len];
+    } else {
+        slot = (u32)map->item_list->len;
+        paged_list_append(map->item_list, item);
+        u32_list_append(map->live_index_list, 0);
+
+        // Generations outlive slot_map_clear, so handles from before it
+        // stay stale.
+        if (slot == map->generation_list->len) {
+            u32_list_append(map->generation_list, 0);
+        }
+    }
+
+    u32 *generation = u32_list_get(map->generation_list, slot);
+    ++*generation;
+
+    *u32_list_get(map->live_index_list, slot) = (u32)map->live_list->len;
+    u32_list_append(map->live_list, slot);
+
+    memcpy(paged_list_get(map->item_list, slot), item, map->item_list->item_size);
+
+    return handle_make(slot, *generation);
+}
+
+// Returns false if the handle was already stale.
+bool slot_map_remove(Slot_Map *map, Handle handle) {
+    if (!slot_map_get(map, handle)) {
+        return false;
+    }
+
+    u32 slot = handle_slot(handle);
+    ++*u32_list_get(map->generation_list, slot);
+    u32_list_append(map->free_list, slot);
+
+    // The last live slot takes the place of the removed one.
+    u32 *live = map->live_list->items;
+    u32 *live_indices = map->live_index_list->items;
+    u32 last = live[--map->live_list->len];
+    live[live_indices[slot]] = last;
+    live_indices[last] = live_indices[slot];
+
+    return true;
+}
+
+// NULL unless handle is an item that is still in the map.
+void *slot_map_get(Slot_Map *map, Handle handle) {
+    u32 slot = handle_slot(handle);
+
+    if (slot >= map->item_list->len || *u32_list_get(map->generation_list, slot) != handle_generation(handle)) {
+        return NULL;
+    }
+
+    return paged_list_get(map->item_list, slot);
+}
+
+// Live slots have odd generations.
+Handle slot_map_handle(Slot_Map *map, u32 slot) {
+    if (slot >= map->item_list->len) {
+        return HANDLE_NONE;
+    }
+
+    u32 generation = *u32_list_get(map->generation_list, slot);
+    return generation % 2 == 1 ? handle_make(slot, generation) : HANDLE_NONE;
+}
+
+// Makes room for count more items, so inserting them won't grow any of
+// the lists.
+void slot_map_reserve(Slot_Map *map, size_t count) {
+    size_t new_slot_count = count > map->free_list->len ? count - map->free_list->len : 0;
+
+    paged_list_reserve(map->item_list, new_slot_count);
+    array_list_grow(map->generation_list, map->item_list->len + new_slot_count);
+    array_list_reserve(map->live_index_list, new_slot_count);
+    array_list_reserve(map->live_list, count);
+}
+
+size_t slot_map_count(Slot_Map *map) {
+    return map->live_list->len;
+}
+
+// The live items, in no particular order. Removing one moves the last live
+// item into its place.
+void *slot_map_at(Slot_Map *map, size_t index) {
+    return paged_list_get(map->item_list, *u32_list_get(map->live_list, index));
+}
+
+void slot_map_clear(Slot_Map *map) {
+    u32 *live = map->live_list->items;
+    u32 *generations = map->generation_list->items;
+
+    for (size_t i = 0; i < map->live_list->len; i++) {
+        ++generations[live[i]];
+    }
+
+    map->item_list->len = 0;
+    map->free_list->len = 0;
+    map->live_list->len = 0;
+    map->live_index_list->len = 0;
+}
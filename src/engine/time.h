@@ -18,3 +18,4 @@ typedef struct time_state {
 void time_init(u32 frame_rate);
 void time_update(void);
 void time_update_late(void);
+f64 time_now_ns(void);
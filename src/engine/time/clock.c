@@ -0,0 +1,8 @@
+#include <SDL2/SDL.h>
+#include "../time.h"
+
+// High resolution clock for measuring short stretches of code. Kept apart
+// from the frame timing so it can be linked without the global state.
+f64 time_now_ns(void) {
+    return (f64)SDL_GetPerformanceCounter() * 1e9 / (f64)SDL_GetPerformanceFrequency();
+}
@@ -58,7 +58,7 @@ typedef struct weapon {
     Projectile_Type projectile_type;
     vec2 sprite_size;
     vec2 sprite_offset;
-    size_t projectile_animation_id;
+    Handle projectile_animation_id;
 } Weapon;
 
 static Weapon weapons[WEAPON_TYPE_COUNT] = {0};
@@ -68,20 +68,22 @@ static f32 height;
 static u32 texture_slots[8] = {0};
 
 static bool should_quit = false;
+// Set by callbacks, the level is rebuilt once physics_update returns.
+static bool should_reset = false;
 
 static bool player_is_grounded = false;
 static Weapon_Type weapon_type = WEAPON_TYPE_PISTOL;
 
-static size_t anim_player_walk_id;
-static size_t anim_player_idle_id;
-static size_t anim_enemy_small_id;
-static size_t anim_enemy_large_id;
-static size_t anim_enemy_small_enraged_id;
-static size_t anim_enemy_large_enraged_id;
-static size_t anim_fire_id;
-static size_t anim_projectile_small_id;
+static Handle anim_player_walk_id;
+static Handle anim_player_idle_id;
+static Handle anim_enemy_small_id;
+static Handle anim_enemy_large_id;
+static Handle anim_enemy_small_enraged_id;
+static Handle anim_enemy_large_enraged_id;
+static Handle anim_fire_id;
+static Handle anim_projectile_small_id;
 
-static size_t player_id;
+static Handle player_id;
 
 static f32 ground_timer = 0;
 static f32 shoot_timer = 0;
@@ -147,12 +149,16 @@ void player_on_hit(Body *self, Body *other, Hit hit) {
 }
 
 void player_on_hit_static(Body *self, Static_Body *other, Hit hit) {
-    if (hit.normal[1] > 0) {
+    if (hit.contact != CONTACT_EXIT && hit.normal[1] > 0) {
         player_is_grounded = true;
     }
 }
 
 void enemy_small_on_hit_static(Body *self, Static_Body *other, Hit hit) {
+    if (hit.contact == CONTACT_EXIT) {
+        return;
+    }
+
     Entity *entity = entity_get(self->entity_id);
 
     if (hit.normal[0] > 0) {
@@ -173,6 +179,10 @@ void enemy_small_on_hit_static(Body *self, Static_Body *other, Hit hit) {
 }
 
 void enemy_large_on_hit_static(Body *self, Static_Body *other, Hit hit) {
+    if (hit.contact == CONTACT_EXIT) {
+        return;
+    }
+
     Entity *entity = entity_get(self->entity_id);
 
     if (hit.normal[0] > 0) {
@@ -198,7 +208,7 @@ void spawn_enemy(bool is_small, bool is_enraged, bool is_flipped) {
     f32 speed = SPEED_ENEMY_LARGE;
     vec2 size = {20, 20};
     vec2 sprite_offset = {0, 10};
-    size_t animation_id = anim_enemy_large_id;
+    Handle animation_id = anim_enemy_large_id;
     On_Hit_Static on_hit_static = enemy_large_on_hit_static;
 
     if (is_small) {
@@ -217,23 +227,27 @@ void spawn_enemy(bool is_small, bool is_enraged, bool is_flipped) {
     }
 
     vec2 velocity = {is_flipped ? -speed : speed, 0};
-    size_t id = entity_create(position, size, sprite_offset, velocity, COLLISION_LAYER_ENEMY, enemy_mask, false, animation_id, NULL, on_hit_static);
+    Handle id = entity_create(position, size, sprite_offset, velocity, COLLISION_LAYER_ENEMY, enemy_mask, false, animation_id, NULL, on_hit_static);
     Entity *entity = entity_get(id);
     entity->is_enraged = is_enraged;
 }
 
-void fire_on_hit(Body *self, Body *other, Hit hit) {
+void fire_on_trigger(Trigger *self, Body *other, Contact_State contact) {
+    if (contact != CONTACT_ENTER) {
+        return;
+    }
+
     if (other->collision_layer == COLLISION_LAYER_ENEMY) {
-        if (other->is_active) {
-            Entity *enemy = entity_get(other->entity_id);
-            bool is_small = enemy->animation_id == anim_enemy_small_id || enemy->animation_id == anim_enemy_small_enraged_id;
-            bool is_flipped = rand() % 100 >= 50;
-            spawn_enemy(is_small, true, is_flipped);
-            enemy->is_active = false;
-            other->is_active = false;
-        }
+        // Only the handle is used after spawning, the callback is done with
+        // the body by then.
+        Handle enemy_id = other->entity_id;
+        Entity *enemy = entity_get(enemy_id);
+        bool is_small = enemy->animation_id == anim_enemy_small_id || enemy->animation_id == anim_enemy_small_enraged_id;
+        bool is_flipped = rand() % 100 >= 50;
+        spawn_enemy(is_small, true, is_flipped);
+        entity_destroy(enemy_id);
     } else if (other->collision_layer == COLLISION_LAYER_PLAYER) {
-        reset();
+        should_reset = true;
     }
 }
 
@@ -247,7 +261,7 @@ void reset(void) {
     spawn_timer = 0;
     shoot_timer = 0;
 
-    player_id = entity_create((vec2){100, 200}, (vec2){24, 24}, (vec2){0, 0}, (vec2){0, 0}, COLLISION_LAYER_PLAYER, player_mask, false, (size_t)-1, player_on_hit, player_on_hit_static);
+    player_id = entity_create((vec2){100, 200}, (vec2){24, 24}, (vec2){0, 0}, (vec2){0, 0}, COLLISION_LAYER_PLAYER, player_mask, false, HANDLE_NONE, player_on_hit, player_on_hit_static);
 
     // init level
     physics_static_body_create((vec2){width * 0.5, height - 16}, (vec2){width, 32}, COLLISION_LAYER_TERRAIN);
@@ -261,19 +275,26 @@ void reset(void) {
     physics_static_body_create((vec2){width * 0.5, 32 * 3 + 24}, (vec2){448, 32}, COLLISION_LAYER_TERRAIN);
     // physics_static_body_create((vec2){16, height - 64}, (vec2){32, 64}, COLLISION_LAYER_ENEMY_PASSTHROUGH);
     // physics_static_body_create((vec2){width - 16, height - 64}, (vec2){32, 64}, COLLISION_LAYER_ENEMY_PASSTHROUGH);
+    physics_static_body_coalesce();
+
+    // Bodies that leave the screen are stepped at a quarter of the rate.
+    physics_lod_set((AABB){{width * 0.5, height * 0.5}, {width * 0.5 + 64, height * 0.5 + 64}}, 4);
 
-    physics_trigger_create((vec2){width * 0.5, -4}, (vec2){64, 8}, 0, fire_mask, fire_on_hit);
+    physics_trigger_create((vec2){width * 0.5, -4}, (vec2){64, 8}, fire_mask, fire_on_trigger);
 
-    entity_create((vec2){width * 0.5, 0}, (vec2){32, 64}, (vec2){0, 0}, (vec2){0, 0}, 0, 0, true, anim_fire_id, NULL, NULL);
-    entity_create((vec2){width * 0.5 + 16, -16}, (vec2){32, 64}, (vec2){0, 0}, (vec2){0, 0}, 0, 0, true, anim_fire_id, NULL, NULL);
-    entity_create((vec2){width * 0.5 - 16, -16}, (vec2){32, 64}, (vec2){0, 0}, (vec2){0, 0}, 0, 0, true, anim_fire_id, NULL, NULL);
+    vec2 fire_positions[] = {{width * 0.5, 0}, {width * 0.5 + 16, -16}, {width * 0.5 - 16, -16}};
+    entity_create_batch(NULL, fire_positions, 3, (vec2){32, 64}, (vec2){0, 0}, (vec2){0, 0}, 0, 0, true, anim_fire_id, NULL, NULL);
 }
 
 int main(int argc, char *argv[]) {
     time_init(60);
     SDL_Window *window = render_init();
     config_init();
+    arena_init(&global.frame_arena, 1 << 20);
+    arena_init(&global.level_arena, 1 << 16);
     physics_init();
+    physics_level_arena_set(&global.level_arena);
+    physics_frame_arena_set(&global.frame_arena);
     entity_init();
     animation_init();
     audio_init();
@@ -336,6 +357,7 @@ int main(int argc, char *argv[]) {
 
     while (!should_quit) {
         time_update();
+        arena_reset(&global.frame_arena);
 
         SDL_Event event;
 
@@ -364,7 +386,13 @@ int main(int argc, char *argv[]) {
 
         input_update();
         input_handle(body_player);
-        physics_update();
+        physics_update(global.time.delta);
+
+        if (should_reset) {
+            should_reset = false;
+            reset();
+        }
+
         animation_update(global.time.delta);
 
         // Spawn enemies.
@@ -386,7 +414,7 @@ int main(int argc, char *argv[]) {
 
         // Debug render bounding boxes
         for (size_t i = 0; i < entity_count(); i++) {
-            Entity *entity = entity_get(i);
+            Entity *entity = entity_at(i);
             Body *body = physics_body_get(entity->body_id);
 
             if (body->is_active) {
@@ -402,8 +430,8 @@ int main(int argc, char *argv[]) {
 
         // Render animated entities...
         for (size_t i = 0; i < entity_count(); i++) {
-            Entity *entity = entity_get(i);
-            if (!entity->is_active || entity->animation_id == (size_t)-1) {
+            Entity *entity = entity_at(i);
+            if (entity->animation_id == HANDLE_NONE) {
                 continue;
             }
 
@@ -418,7 +446,8 @@ int main(int argc, char *argv[]) {
 
             vec2 pos;
 
-            vec2_add(pos, body->aabb.position, entity->sprite_offset);
+            physics_body_position_interpolated(pos, entity->body_id);
+            vec2_add(pos, pos, entity->sprite_offset);
             animation_render(anim, pos, (vec4){1, 1, 1, 1}, texture_slots);
         }
 